@@ -2,10 +2,48 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+// Override both to run more than one monitor against the same broker
+#ifndef HOSTNAME
 #define HOSTNAME "well-control"
+#endif
 #define OTA_PORT 3232
 
+// Every topic is derived from this at compile time (see topics.h)
+#ifndef MQTT_ROOT
 #define MQTT_ROOT "well/monitor"
-#define MQTT_TOPIC_LOG "well/monitor/log"
+// HomeAssistant unique_id of the pump switch, kept from before it was derived
+// from MQTT_ROOT so existing installs don't get a second switch entity
+#ifndef HA_SWITCH_UNIQUE_ID
+#define HA_SWITCH_UNIQUE_ID "well_pump_power_switch"
+#endif
+#endif
 
-#endif /* !CONFIG_H */
\ No newline at end of file
+// Stream every raw ADC capture block to Topics::TRACE (see trace.h)
+#ifndef TRACE_RECORDING
+#define TRACE_RECORDING 0
+#endif
+
+// Payload format for the per-poll state and metrics
+#define TELEMETRY_TEXT 0  // Decimal text, one value per topic
+#define TELEMETRY_CBOR 1  // One CBOR frame each for state and metrics (see telemetry.h)
+#ifndef TELEMETRY_FORMAT
+#define TELEMETRY_FORMAT TELEMETRY_TEXT
+#endif
+
+// A poll cycle not finished this long after it was due counts as a deadline miss (see looptiming.h).
+// The cycle that sees the relay close also busy-waits for the 400ms inrush capture (see ctsensor.h).
+#ifndef LOOP_DEADLINE_MS
+#define LOOP_DEADLINE_MS 2000
+#endif
+
+// Create tasks, timers and semaphores from static buffers (see rambudget.h)
+#ifndef STATIC_ALLOCATION
+#define STATIC_ALLOCATION 0
+#endif
+
+// Dynamic CPU frequency, automatic light sleep and Wi-Fi modem sleep (see power.h)
+#ifndef POWER_MANAGEMENT
+#define POWER_MANAGEMENT 0
+#endif
+
+#endif /* !CONFIG_H */
@@ -2,14 +2,37 @@
 #ifndef CTSENSOR_H
 #define CTSENSOR_H
 
+#include "config.h"
 #include "state.h"
+#include "pumplogic.h"
+#include "trace.h"
+
+#define CT_NUM_SAMPLES 1000 // Number of samples before calculating RMS
+
+#define INRUSH_NUM_SAMPLES 4000 // Burst taken when the relay closes, 400ms
+#define INRUSH_SAMPLE_US 100    // 10kHz, about 166 samples per mains cycle
+
+#define TRACE_BUF_BYTES (TRACE_HEADER_BYTES + 2 + (CT_NUM_SAMPLES - 1) * 3)  // One packed capture
 
 extern SemaphoreHandle_t xSemaphoreADC;
-extern TimerHandle_t backoffTimerHandle;
-extern const double offset;
-extern const float badLoadWattsLow;
-extern const float badLoadWattsHigh;
+extern const PumpConfig pumpConfig;
+
+// Capture buffers, sized here so rambudget.cpp can measure them
+extern uint16_t ctSamples[CT_NUM_SAMPLES];
+extern uint16_t inrushSamples[INRUSH_NUM_SAMPLES];
+#if TRACE_RECORDING
+extern uint8_t traceBuf[TRACE_BUF_BYTES];
+#endif
+
+void setupCTSensor();
+
+// Current estimate of the DC offset on the CT input
+double ctOffsetVolts();
 
 double readCTApparentPower(int pin, State *state);
 
-#endif /* !CTSENSOR_H */
\ No newline at end of file
+// Sample the start-up current right after the relay closed, publish its
+// features and update the persisted trend (see inrush.h)
+void captureInrush(int pin);
+
+#endif /* !CTSENSOR_H */
@@ -1,3 +1,6 @@
-#include <ArduinoJson.hpp>
+#define HA_JSON_BYTES 500 // Size of the discovery JSON output buffer
+
+// Type of the discovery buffer, a static in homeassistant.cpp with STATIC_ALLOCATION
+typedef char HADiscoveryBuffer[HA_JSON_BYTES];
 
 void HASetupSensors();
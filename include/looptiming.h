@@ -0,0 +1,26 @@
+/* looptiming.h */
+#ifndef LOOPTIMING_H
+#define LOOPTIMING_H
+
+#include <stdint.h>
+
+// Timing of the taskPollSensors control loop from the microsecond timer.
+//
+// Each cycle is released every period. Lateness is how long after its release
+// a cycle started, jitter is how far the start-to-start interval was from the
+// period. A cycle that hasn't finished LOOP_DEADLINE_MS after its release is
+// a deadline miss, and a timer at the deadline records what was running on
+// each core at that moment.
+
+#define LOOP_HIST_BUCKETS 6  // <100us, <1ms, <10ms, <100ms, <1s, longer
+
+void loopTimingInit(uint32_t periodMs, uint32_t deadlineMs);
+
+// Call first and last thing in every cycle
+void loopTimingStart();
+void loopTimingEnd();
+
+// Publish the last cycle's figures, the histograms too when histograms is set
+void loopTimingPublish(bool histograms);
+
+#endif /* !LOOPTIMING_H */
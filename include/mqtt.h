@@ -2,6 +2,12 @@
 #ifndef MQTT_H
 #define MQTT_H
 
+#include <Arduino.h>
+
+#include "config.h"
+#include "telemetry.h"
+#include "publish.h"
+
 // #define MQTT_HOST IPAddress(192, 168, 1, 10)
 #define MQTT_HOST "homeassistant.local"
 #define MQTT_PORT 1883
@@ -13,6 +19,22 @@ void setupMQTT();
 
 uint16_t mqttPublish(const char* topic, uint8_t qos, bool retain, const char* payload);
 
+uint16_t mqttPublishBinary(const char* topic, uint8_t qos, bool retain, const uint8_t* payload, size_t length);
+
 uint16_t mqttLog(const char* msg);
 
+#if STATIC_ALLOCATION
+extern StaticTimer_t mqttReconnectTimerBuffer;
+#endif
+
+// Sink for publish.h that sends through the MQTT client
+extern const PublishSink mqttSink;
+
+// Publish a metric as text on its key's topic (see topics.h), or add it to the
+// metrics frame with TELEMETRY_CBOR
+void mqttPublishMetric(TelemetryKey key, float value, unsigned char decimals);
+
+// Send the metrics frame collected since the last flush (TELEMETRY_CBOR only)
+void mqttFlushMetrics();
+
 #endif /* !MQTT_H */
\ No newline at end of file
@@ -0,0 +1,26 @@
+/* power.h */
+#ifndef POWER_H
+#define POWER_H
+
+// Power management (POWER_MANAGEMENT in config.h): dynamic CPU frequency,
+// automatic light sleep and Wi-Fi modem sleep. The lock calls are no-ops
+// when power management is disabled.
+
+void setupPower();
+
+// Turn on Wi-Fi modem sleep, call after every successful connect
+void powerWifiConnected();
+
+// Hold APB at max frequency and block light sleep during an ADC capture
+void powerLockADC();
+void powerUnlockADC();
+
+// Hold the CPU at max frequency while publishing a burst of messages
+void powerLockNet();
+void powerUnlockNet();
+
+// Publish lock residency and the estimated average supply current, the
+// baseline current when esp_pm_configure() failed
+void powerPublishMetrics();
+
+#endif /* !POWER_H */
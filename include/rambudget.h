@@ -0,0 +1,20 @@
+/* rambudget.h */
+#ifndef RAMBUDGET_H
+#define RAMBUDGET_H
+
+// Upper bound for the statically allocated buffers listed in rambudget.cpp,
+// checked at compile time
+#ifndef STATIC_RAM_BUDGET
+#define STATIC_RAM_BUDGET (48 * 1024)
+#endif
+
+// Bytes of RAM in the static allocation table
+unsigned int ramBudgetStaticBytes();
+
+// Log the static allocation table and current heap use
+void ramBudgetLog();
+
+// Publish per-task stack high water marks and heap use
+void ramBudgetReport();
+
+#endif /* !RAMBUDGET_H */
@@ -2,9 +2,12 @@
 #ifndef STATE_H
 #define STATE_H
 
+#include <stdint.h>
+
 struct State {
     bool backoff;
     unsigned long backoffTimeoutSeconds;
+    uint8_t pumpState;      // PumpState from pumpcontrol.h
     unsigned int pumpNotOkCount;
     bool pumpOn;
     bool pumpOk;
@@ -4,6 +4,9 @@
 
 #include <Arduino.h>
 
+#include "config.h"
+#include "history.h"
+
 // Timers
 extern unsigned int const WIFI_WATCHDOG_MS;
 extern unsigned int const WIFI_TIMEOUT_MS;   
@@ -12,9 +15,30 @@ extern unsigned int const period;
 extern unsigned int const ONE_HOUR_PERIOD_MS;   
 extern unsigned int const TWO_HOUR_PERIOD_MS;
 
+// Task stack sizes in bytes, see the stack high water marks from ramBudgetReport()
+#define STACK_WIFI         5000
+#define STACK_POLL_SENSORS 5000
+#define STACK_BLINKER      900
+
+// Compressed power history blocks kept in RAM
+#define HISTORY_BLOCKS 2
+extern HistoryBlock historyBlocks[HISTORY_BLOCKS];
+
+#if STATIC_ALLOCATION
+// Task stacks and control blocks, defined in main.cpp
+extern StackType_t stackBlinker[STACK_BLINKER];
+extern StackType_t stackWifi[STACK_WIFI];
+extern StackType_t stackPollSensors[STACK_POLL_SENSORS];
+extern StaticTask_t tcbBlinker;
+extern StaticTask_t tcbWifi;
+extern StaticTask_t tcbPollSensors;
+extern StaticSemaphore_t semaphoreADCBuffer;
+#endif
+
 // Task handles
 extern TaskHandle_t hPollSensors;
 extern TaskHandle_t hBlinker;
+extern TaskHandle_t hWifi;
 
 void taskBlinkLED(void * parameter);
 
@@ -22,4 +46,7 @@ void taskWifi(void * parameter);
 
 void taskPollSensors(void * vParameter);
 
+// Queue a PUMP_EV_MANUAL_* event for the pump controller, safe from other tasks
+void requestPumpOverride(int event);
+
 #endif /* !TASKS_H */
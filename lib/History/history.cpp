@@ -0,0 +1,368 @@
+#include <string.h>
+
+#include "history.h"
+
+/* Bit IO */
+
+void bitWriterInit(BitWriter *w, uint8_t *buf, size_t cap) {
+    w->buf = buf;
+    w->cap = cap;
+    w->bitPos = 0;
+    w->overflow = false;
+}
+
+void bitWrite(BitWriter *w, uint32_t value, uint8_t nbits) {
+    if(w->bitPos + nbits > w->cap * 8) {
+        w->overflow = true;
+        return;
+    }
+
+    // Write MSB first, a byte-sized chunk at a time
+    while(nbits > 0) {
+        size_t byte = w->bitPos >> 3;
+        uint8_t used = w->bitPos & 7;
+        uint8_t room = 8 - used;
+        uint8_t n = nbits < room ? nbits : room;
+        uint8_t chunk = (value >> (nbits - n)) & ((1u << n) - 1);
+
+        uint8_t mask = ((1u << n) - 1) << (room - n);
+        w->buf[byte] = (w->buf[byte] & ~mask) | (chunk << (room - n));
+
+        w->bitPos += n;
+        nbits -= n;
+    }
+}
+
+size_t bitWriterBytes(const BitWriter *w) {
+    return (w->bitPos + 7) >> 3;
+}
+
+void bitReaderInit(BitReader *r, const uint8_t *buf, size_t len) {
+    r->buf = buf;
+    r->len = len;
+    r->bitPos = 0;
+    r->overflow = false;
+}
+
+uint32_t bitRead(BitReader *r, uint8_t nbits) {
+    if(r->bitPos + nbits > r->len * 8) {
+        r->overflow = true;
+        return 0;
+    }
+
+    uint32_t value = 0;
+    while(nbits > 0) {
+        size_t byte = r->bitPos >> 3;
+        uint8_t used = r->bitPos & 7;
+        uint8_t room = 8 - used;
+        uint8_t n = nbits < room ? nbits : room;
+
+        value = (value << n) | ((r->buf[byte] >> (room - n)) & ((1u << n) - 1));
+
+        r->bitPos += n;
+        nbits -= n;
+    }
+    return value;
+}
+
+/* Delta-of-delta timestamps
+ *
+ *  '0'                 dod == 0
+ *  '10'   + 7 bits     dod in [-63, 64]
+ *  '110'  + 9 bits     dod in [-255, 256]
+ *  '1110' + 12 bits    dod in [-2047, 2048]
+ *  '1111' + 32 bits    anything else
+ *
+ * The first timestamp is stored raw in 32 bits.
+ */
+
+void timeEncoderInit(TimeEncoder *e, uint8_t *buf, size_t cap) {
+    bitWriterInit(&e->w, buf, cap);
+    e->count = 0;
+    e->prevTime = 0;
+    e->prevDelta = 0;
+}
+
+bool timeEncoderAppend(TimeEncoder *e, uint32_t t) {
+    if(e->count == 0) {
+        bitWrite(&e->w, t, 32);
+    } else {
+        int32_t delta = (int32_t)(t - e->prevTime);
+        int32_t dod = delta - e->prevDelta;
+
+        if(dod == 0) {
+            bitWrite(&e->w, 0x0, 1);
+        } else if(dod >= -63 && dod <= 64) {
+            bitWrite(&e->w, 0x2, 2);
+            bitWrite(&e->w, (uint32_t)(dod + 63), 7);
+        } else if(dod >= -255 && dod <= 256) {
+            bitWrite(&e->w, 0x6, 3);
+            bitWrite(&e->w, (uint32_t)(dod + 255), 9);
+        } else if(dod >= -2047 && dod <= 2048) {
+            bitWrite(&e->w, 0xE, 4);
+            bitWrite(&e->w, (uint32_t)(dod + 2047), 12);
+        } else {
+            bitWrite(&e->w, 0xF, 4);
+            bitWrite(&e->w, (uint32_t)dod, 32);
+        }
+        e->prevDelta = delta;
+    }
+
+    e->prevTime = t;
+    e->count++;
+    return !e->w.overflow;
+}
+
+void timeDecoderInit(TimeDecoder *d, const uint8_t *buf, size_t len) {
+    bitReaderInit(&d->r, buf, len);
+    d->prevTime = 0;
+    d->prevDelta = 0;
+    d->first = true;
+}
+
+bool timeDecoderNext(TimeDecoder *d, uint32_t *t) {
+    if(d->first) {
+        d->prevTime = bitRead(&d->r, 32);
+        d->first = false;
+    } else {
+        int32_t dod;
+        if(bitRead(&d->r, 1) == 0) {
+            dod = 0;
+        } else if(bitRead(&d->r, 1) == 0) {
+            dod = (int32_t)bitRead(&d->r, 7) - 63;
+        } else if(bitRead(&d->r, 1) == 0) {
+            dod = (int32_t)bitRead(&d->r, 9) - 255;
+        } else if(bitRead(&d->r, 1) == 0) {
+            dod = (int32_t)bitRead(&d->r, 12) - 2047;
+        } else {
+            dod = (int32_t)bitRead(&d->r, 32);
+        }
+        d->prevDelta += dod;
+        d->prevTime += d->prevDelta;
+    }
+
+    *t = d->prevTime;
+    return !d->r.overflow;
+}
+
+/* Gorilla XOR floats
+ *
+ *  '0'                                   same value as previous
+ *  '10' + meaningful bits                XOR fits the previous leading/trailing window
+ *  '11' + 5 bits leading + 5 bits (len - 1) + meaningful bits
+ *
+ * The first value is stored raw in 32 bits.
+ */
+
+static uint32_t floatBits(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(uint32_t bits) {
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static uint8_t leadingZeros(uint32_t x) {
+    uint8_t n = 0;
+    while(n < 32 && !(x & 0x80000000u)) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+}
+
+static uint8_t trailingZeros(uint32_t x) {
+    uint8_t n = 0;
+    while(n < 32 && !(x & 1u)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+}
+
+void xorEncoderInit(XorEncoder *e, uint8_t *buf, size_t cap) {
+    bitWriterInit(&e->w, buf, cap);
+    e->count = 0;
+    e->prevBits = 0;
+    e->prevLeading = 0xFF;
+    e->prevTrailing = 0;
+}
+
+bool xorEncoderAppend(XorEncoder *e, float v) {
+    uint32_t bits = floatBits(v);
+
+    if(e->count == 0) {
+        bitWrite(&e->w, bits, 32);
+    } else {
+        uint32_t x = bits ^ e->prevBits;
+
+        if(x == 0) {
+            bitWrite(&e->w, 0x0, 1);
+        } else {
+            uint8_t leading = leadingZeros(x);
+            uint8_t trailing = trailingZeros(x);
+
+            if(e->prevLeading != 0xFF && leading >= e->prevLeading && trailing >= e->prevTrailing) {
+                uint8_t len = 32 - e->prevLeading - e->prevTrailing;
+                bitWrite(&e->w, 0x2, 2);
+                bitWrite(&e->w, x >> e->prevTrailing, len);
+            } else {
+                uint8_t len = 32 - leading - trailing;
+                bitWrite(&e->w, 0x3, 2);
+                bitWrite(&e->w, leading, 5);
+                bitWrite(&e->w, len - 1, 5);
+                bitWrite(&e->w, x >> trailing, len);
+                e->prevLeading = leading;
+                e->prevTrailing = trailing;
+            }
+        }
+    }
+
+    e->prevBits = bits;
+    e->count++;
+    return !e->w.overflow;
+}
+
+void xorDecoderInit(XorDecoder *d, const uint8_t *buf, size_t len) {
+    bitReaderInit(&d->r, buf, len);
+    d->prevBits = 0;
+    d->prevLeading = 0;
+    d->prevTrailing = 0;
+    d->first = true;
+}
+
+bool xorDecoderNext(XorDecoder *d, float *v) {
+    if(d->first) {
+        d->prevBits = bitRead(&d->r, 32);
+        d->first = false;
+    } else if(bitRead(&d->r, 1) == 1) {
+        if(bitRead(&d->r, 1) == 1) {
+            d->prevLeading = bitRead(&d->r, 5);
+            uint8_t len = bitRead(&d->r, 5) + 1;
+            d->prevTrailing = 32 - d->prevLeading - len;
+        }
+        uint8_t len = 32 - d->prevLeading - d->prevTrailing;
+        d->prevBits ^= bitRead(&d->r, len) << d->prevTrailing;
+    }
+
+    *v = bitsFloat(d->prevBits);
+    return !d->r.overflow;
+}
+
+/* Zig-zag varints */
+
+uint32_t zigzagEncode(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+int32_t zigzagDecode(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static int32_t quantise(float v, float scale) {
+    float q = v * scale;
+    return (int32_t)(q < 0 ? q - 0.5f : q + 0.5f);
+}
+
+void varintEncoderInit(VarintEncoder *e, uint8_t *buf, size_t cap, float scale) {
+    e->buf = buf;
+    e->cap = cap;
+    e->len = 0;
+    e->count = 0;
+    e->scale = scale;
+    e->prev = 0;
+}
+
+bool varintEncoderAppend(VarintEncoder *e, float v) {
+    int32_t q = quantise(v, e->scale);
+    uint32_t z = zigzagEncode(q - e->prev);
+
+    // LEB128, 7 bits per byte, high bit set on all but the last byte
+    uint8_t tmp[5];
+    size_t n = 0;
+    do {
+        tmp[n] = z & 0x7F;
+        z >>= 7;
+        if(z) {
+            tmp[n] |= 0x80;
+        }
+        n++;
+    } while(z);
+
+    if(e->len + n > e->cap) {
+        return false;
+    }
+
+    memcpy(e->buf + e->len, tmp, n);
+    e->len += n;
+    e->prev = q;
+    e->count++;
+    return true;
+}
+
+void varintDecoderInit(VarintDecoder *d, const uint8_t *buf, size_t len, float scale) {
+    d->buf = buf;
+    d->len = len;
+    d->pos = 0;
+    d->scale = scale;
+    d->prev = 0;
+}
+
+bool varintDecoderNext(VarintDecoder *d, float *v) {
+    uint32_t z = 0;
+    uint8_t shift = 0;
+
+    while(true) {
+        if(d->pos >= d->len || shift > 28) {
+            return false;
+        }
+        uint8_t byte = d->buf[d->pos++];
+        z |= (uint32_t)(byte & 0x7F) << shift;
+        shift += 7;
+        if(!(byte & 0x80)) {
+            break;
+        }
+    }
+
+    d->prev += zigzagDecode(z);
+    *v = d->prev / d->scale;
+    return true;
+}
+
+/* History block */
+
+void historyBlockInit(HistoryBlock *b) {
+    timeEncoderInit(&b->time, b->timeBuf, sizeof(b->timeBuf));
+    xorEncoderInit(&b->power, b->powerBuf, sizeof(b->powerBuf));
+    xorEncoderInit(&b->current, b->currentBuf, sizeof(b->currentBuf));
+    b->count = 0;
+}
+
+bool historyBlockAppend(HistoryBlock *b, uint32_t t, float power, float current) {
+    // Encoders are plain structs so a copy is enough to roll back a partial append
+    TimeEncoder time = b->time;
+    XorEncoder p = b->power;
+    XorEncoder c = b->current;
+
+    bool ok = timeEncoderAppend(&b->time, t);
+    ok = ok && xorEncoderAppend(&b->power, power);
+    ok = ok && xorEncoderAppend(&b->current, current);
+
+    if(!ok) {
+        b->time = time;
+        b->power = p;
+        b->current = c;
+        return false;
+    }
+
+    b->count++;
+    return true;
+}
+
+size_t historyBlockBytes(const HistoryBlock *b) {
+    return bitWriterBytes(&b->time.w) + bitWriterBytes(&b->power.w) + bitWriterBytes(&b->current.w);
+}
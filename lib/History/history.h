@@ -0,0 +1,130 @@
+/* history.h */
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Compact column encoders for on-device sample history.
+//
+// Timestamps are stored as delta-of-delta (Gorilla style variable length
+// buckets), values either as XOR'd IEEE floats or as zig-zag varints of a
+// fixed-point quantised delta. Every column writes into a caller-owned
+// buffer so nothing here touches the heap.
+
+#define HISTORY_COLUMN_BYTES 512  // Bytes per column in a HistoryBlock
+
+struct BitWriter {
+    uint8_t *buf;
+    size_t cap;      // Capacity in bytes
+    size_t bitPos;   // Next bit to write
+    bool overflow;   // Set once a write did not fit
+};
+
+struct BitReader {
+    const uint8_t *buf;
+    size_t len;      // Length in bytes
+    size_t bitPos;
+    bool overflow;   // Set once a read ran past the end
+};
+
+void bitWriterInit(BitWriter *w, uint8_t *buf, size_t cap);
+void bitWrite(BitWriter *w, uint32_t value, uint8_t nbits);
+size_t bitWriterBytes(const BitWriter *w);
+
+void bitReaderInit(BitReader *r, const uint8_t *buf, size_t len);
+uint32_t bitRead(BitReader *r, uint8_t nbits);
+
+/* Delta-of-delta timestamp column */
+
+struct TimeEncoder {
+    BitWriter w;
+    uint32_t count;
+    uint32_t prevTime;
+    int32_t prevDelta;
+};
+
+struct TimeDecoder {
+    BitReader r;
+    uint32_t prevTime;
+    int32_t prevDelta;
+    bool first;
+};
+
+void timeEncoderInit(TimeEncoder *e, uint8_t *buf, size_t cap);
+bool timeEncoderAppend(TimeEncoder *e, uint32_t t);
+void timeDecoderInit(TimeDecoder *d, const uint8_t *buf, size_t len);
+bool timeDecoderNext(TimeDecoder *d, uint32_t *t);
+
+/* Gorilla XOR float column */
+
+struct XorEncoder {
+    BitWriter w;
+    uint32_t count;
+    uint32_t prevBits;
+    uint8_t prevLeading;
+    uint8_t prevTrailing;
+};
+
+struct XorDecoder {
+    BitReader r;
+    uint32_t prevBits;
+    uint8_t prevLeading;
+    uint8_t prevTrailing;
+    bool first;
+};
+
+void xorEncoderInit(XorEncoder *e, uint8_t *buf, size_t cap);
+bool xorEncoderAppend(XorEncoder *e, float v);
+void xorDecoderInit(XorDecoder *d, const uint8_t *buf, size_t len);
+bool xorDecoderNext(XorDecoder *d, float *v);
+
+/* Zig-zag varint column of quantised deltas (value * scale rounded) */
+
+struct VarintEncoder {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    uint32_t count;
+    float scale;
+    int32_t prev;
+};
+
+struct VarintDecoder {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    float scale;
+    int32_t prev;
+};
+
+void varintEncoderInit(VarintEncoder *e, uint8_t *buf, size_t cap, float scale);
+bool varintEncoderAppend(VarintEncoder *e, float v);
+void varintDecoderInit(VarintDecoder *d, const uint8_t *buf, size_t len, float scale);
+bool varintDecoderNext(VarintDecoder *d, float *v);
+
+uint32_t zigzagEncode(int32_t v);
+int32_t zigzagDecode(uint32_t v);
+
+/* A block of pump history: timestamp, power and current columns */
+
+struct HistoryBlock {
+    uint8_t timeBuf[HISTORY_COLUMN_BYTES];
+    uint8_t powerBuf[HISTORY_COLUMN_BYTES];
+    uint8_t currentBuf[HISTORY_COLUMN_BYTES];
+
+    TimeEncoder time;
+    XorEncoder power;
+    XorEncoder current;
+    uint32_t count;
+};
+
+void historyBlockInit(HistoryBlock *b);
+
+// Append one sample, returns false (and leaves the block unchanged) when full
+bool historyBlockAppend(HistoryBlock *b, uint32_t t, float power, float current);
+
+// Total encoded size of all columns in bytes
+size_t historyBlockBytes(const HistoryBlock *b);
+
+#endif /* !HISTORY_H */
@@ -0,0 +1,162 @@
+#include <string.h>
+
+#include "publish.h"
+#include "pumpcontrol.h"
+#include "telemetry.h"
+#include "textwriter.h"
+#include "topics.h"
+
+void publishText(const PublishSink *sink, const char *topic, uint8_t qos, bool retain, const char *payload) {
+    sink->publish(sink->ctx, topic, qos, retain, (const uint8_t *)payload, strlen(payload));
+}
+
+static void publishWriter(const PublishSink *sink, const char *topic, uint8_t qos, bool retain, const TextWriter *w) {
+    if(!w->overflow) {
+        sink->publish(sink->ctx, topic, qos, retain, (const uint8_t *)w->buf, w->len);
+    }
+}
+
+static void publishUint(const PublishSink *sink, const char *topic, uint8_t qos, bool retain, uint32_t value) {
+    char v[16];
+    TextWriter w;
+    textWriterInit(&w, v, sizeof(v));
+    textWriteUint(&w, value);
+    publishWriter(sink, topic, qos, retain, &w);
+}
+
+// Two decimals, as Arduino's String(float) gave
+static void publishFixed2(const PublishSink *sink, const char *topic, float value) {
+    char v[24];
+    TextWriter w;
+    textWriterInit(&w, v, sizeof(v));
+    textWriteFixed(&w, value, 2);
+    publishWriter(sink, topic, 0, false, &w);
+}
+
+void publishStateText(const PublishSink *sink, const State *state) {
+    // Send inverse of pin read to mqtt as these are PULL DOWN pins where LOW == TRUE
+    publishText(sink, Topics::TLM_WATER_REQUEST_1.s, 0, false, state->req1 ? "0" : "1");
+    publishText(sink, Topics::TLM_WATER_REQUEST_2.s, 0, false, state->req2 ? "0" : "1");
+
+    publishText(sink, Topics::TLM_PUMP_ON.s, 0, false, state->pumpOn ? "ON" : "OFF");
+    publishText(sink, Topics::TLM_PUMP_STATE.s, 0, true, pumpStateName(state->pumpState));
+
+    publishText(sink, Topics::TLM_BACKOFF.s, 0, true, state->backoff ? "ON" : "OFF");
+    publishUint(sink, Topics::TLM_PUMP_NOT_OK_COUNT.s, 0, true, state->pumpNotOkCount);
+
+    publishFixed2(sink, Topics::TLM_MAINS_VOLTS.s, state->voltage);
+    publishFixed2(sink, Topics::TLM_CURRENT_AMPS.s, state->current);
+    publishFixed2(sink, Topics::TLM_POWER_WATTS.s, state->power);
+
+    publishUint(sink, Topics::TLM_BACKOFF_TIMEOUT_S.s, 0, false, state->backoffTimeoutSeconds);
+}
+
+void publishStateCbor(const PublishSink *sink, const State *state, uint32_t timeMs, uint8_t *buf, size_t cap) {
+    // One frame carries everything the per-value topics would
+    size_t len = telemetryEncodeState(state, timeMs, buf, cap);
+    if(len > 0) {
+        sink->publish(sink->ctx, Topics::CBOR_STATE.s, 0, true, buf, len);
+    }
+}
+
+void publishHAState(const PublishSink *sink, const State *state) {
+    char l[100];
+    TextWriter w;
+    textWriterInit(&w, l, sizeof(l));
+    textWriteStr(&w, "{\"state\": \"");
+    textWriteStr(&w, state->pumpOn ? "ON" : "OFF");
+    textWriteStr(&w, "\", \"current\": ");
+    textWriteFixed(&w, state->current, 2);
+    textWriteStr(&w, ", \"power\": ");
+    textWriteFixed(&w, state->power, 0);
+    textWriteStr(&w, "}");
+    publishWriter(sink, Topics::HA_STATE.s, 0, true, &w);
+}
+
+struct DiscoveryConfig {
+    const char *topic;
+    const char *name;
+    const char *uniqueId;
+    const char *deviceClass;
+    const char *valueTemplate;
+    const char *commandTopic;  // NULL for sensors
+    const char *payloadPress;  // Buttons only, they have no state, class or template
+};
+
+constexpr auto HA_ID_PUMP_STATE = topicJoin(HA_NODE_ID.s, "_pump_state");
+constexpr auto HA_ID_PUMP_CURRENT = topicJoin(HA_NODE_ID.s, "_pump_current");
+constexpr auto HA_ID_PUMP_POWER = topicJoin(HA_NODE_ID.s, "_pump_power");
+// Only derived when MQTT_ROOT is overridden, see config.h
+#ifdef HA_SWITCH_UNIQUE_ID
+constexpr auto HA_ID_PUMP_SWITCH = topicJoin(HA_SWITCH_UNIQUE_ID, "");
+#else
+constexpr auto HA_ID_PUMP_SWITCH = topicJoin(HA_NODE_ID.s, "_pump_switch");
+#endif
+constexpr auto HA_ID_PUMP_AUTO = topicJoin(HA_NODE_ID.s, "_pump_auto");
+
+const DiscoveryConfig discoveryConfigs[] = {
+    /* Well Pump Binary Sensor */
+    { Topics::HA_PUMP_CONFIG.s,
+      "Well Monitor: Pump State", HA_ID_PUMP_STATE.s, "power", "{{ value_json.state }}", NULL, NULL },
+
+    /* Well Pump Sensor - Pump Current and Power */
+    { Topics::HA_CURRENT_CONFIG.s,
+      "Well Monitor: Pump Current", HA_ID_PUMP_CURRENT.s, "current", "{{ value_json.current }}", NULL, NULL },
+    { Topics::HA_POWER_CONFIG.s,
+      "Well Monitor: Pump Power", HA_ID_PUMP_POWER.s, "power", "{{ value_json.power }}", NULL, NULL },
+
+    /* Well Pump Switch, ON/OFF put the pump in manual */
+    { Topics::HA_SWITCH_CONFIG.s,
+      "Well Monitor: Pump Switch", HA_ID_PUMP_SWITCH.s, "switch", "{{ value_json.state }}", Topics::HA_SWITCH_SET.s, NULL },
+
+    /* Well Pump Auto Button, hands the pump back to automatic control */
+    { Topics::HA_AUTO_CONFIG.s,
+      "Well Monitor: Pump Auto", HA_ID_PUMP_AUTO.s, NULL, NULL, Topics::PUMP_OVERRIDE.s, "AUTO" }
+};
+
+void publishDiscovery(const PublishSink *sink, char *buf, size_t cap) {
+    for(size_t i = 0; i < sizeof(discoveryConfigs) / sizeof(discoveryConfigs[0]); i++) {
+        const DiscoveryConfig *c = &discoveryConfigs[i];
+
+        // Same key order and spacing serializeJson() produced, none of the values need escaping
+        TextWriter w;
+        textWriterInit(&w, buf, cap);
+        textWriteStr(&w, "{\"name\":\"");
+        textWriteStr(&w, c->name);
+        textWriteStr(&w, "\",\"unique_id\":\"");
+        textWriteStr(&w, c->uniqueId);
+        if(c->payloadPress == NULL) {
+            textWriteStr(&w, "\",\"device_class\":\"");
+            textWriteStr(&w, c->deviceClass);
+            textWriteStr(&w, "\",\"state_topic\":\"");
+            textWriteStr(&w, Topics::HA_STATE.s);
+            textWriteStr(&w, "\",\"value_template\":\"");
+            textWriteStr(&w, c->valueTemplate);
+        }
+        if(c->commandTopic != NULL) {
+            textWriteStr(&w, "\",\"cmd_t\":\"");
+            textWriteStr(&w, c->commandTopic);
+        }
+        if(c->payloadPress != NULL) {
+            textWriteStr(&w, "\",\"payload_press\":\"");
+            textWriteStr(&w, c->payloadPress);
+        }
+        textWriteStr(&w, "\"}");
+        publishWriter(sink, c->topic, 0, false, &w);
+    }
+}
+
+bool isOverrideTopic(const char *topic) {
+    return strcmp(topic, Topics::PUMP_OVERRIDE.s) == 0 || strcmp(topic, Topics::HA_SWITCH_SET.s) == 0;
+}
+
+int overrideEvent(const char *payload, size_t len) {
+    if(len == 2 && strncmp(payload, "ON", len) == 0) {
+        return PUMP_EV_MANUAL_ON;
+    } else if(len == 3 && strncmp(payload, "OFF", len) == 0) {
+        return PUMP_EV_MANUAL_OFF;
+    } else if(len == 4 && strncmp(payload, "AUTO", len) == 0) {
+        return PUMP_EV_MANUAL_RELEASE;
+    }
+    return -1;
+}
@@ -0,0 +1,40 @@
+/* publish.h */
+#ifndef PUBLISH_H
+#define PUBLISH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "state.h"
+
+// Hardware independent half of the MQTT publishing: which topics go out and
+// what their payloads look like. The firmware hands in a sink that calls
+// AsyncMqttClient, tools/fleetsim hands in one per virtual device.
+
+struct PublishSink {
+    void (*publish)(void *ctx, const char *topic, uint8_t qos, bool retain, const uint8_t *payload, size_t len);
+    void *ctx;
+};
+
+void publishText(const PublishSink *sink, const char *topic, uint8_t qos, bool retain, const char *payload);
+
+// One decimal text topic per State value (TELEMETRY_TEXT)
+void publishStateText(const PublishSink *sink, const State *state);
+
+// State as one TLM_FRAME_STATE frame (TELEMETRY_CBOR), encoded into buf
+void publishStateCbor(const PublishSink *sink, const State *state, uint32_t timeMs, uint8_t *buf, size_t cap);
+
+// HomeAssistant state JSON, sent in both formats
+void publishHAState(const PublishSink *sink, const State *state);
+
+// HomeAssistant discovery configs, buf holds one config at a time
+void publishDiscovery(const PublishSink *sink, char *buf, size_t cap);
+
+// Override commands arrive on Topics::PUMP_OVERRIDE or Topics::HA_SWITCH_SET
+bool isOverrideTopic(const char *topic);
+
+// PumpEvent for an ON, OFF or AUTO payload (not NUL terminated), -1 if unknown.
+// The HomeAssistant switch sends ON/OFF, its Pump Auto button sends AUTO.
+int overrideEvent(const char *payload, size_t len);
+
+#endif /* !PUBLISH_H */
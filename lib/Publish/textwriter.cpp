@@ -0,0 +1,93 @@
+#include <math.h>
+
+#include "textwriter.h"
+
+#define TEXT_MAX_DECIMALS 6
+
+static const uint32_t powersOf10[TEXT_MAX_DECIMALS + 1] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+void textWriterInit(TextWriter *w, char *buf, size_t cap) {
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->overflow = cap == 0;
+    if(cap > 0) {
+        buf[0] = '\0';
+    }
+}
+
+static void putChar(TextWriter *w, char c) {
+    if(w->len + 1 >= w->cap) {
+        w->overflow = true;
+        return;
+    }
+    w->buf[w->len++] = c;
+    w->buf[w->len] = '\0';
+}
+
+void textWriteStr(TextWriter *w, const char *s) {
+    while(*s != '\0') {
+        putChar(w, *s++);
+    }
+}
+
+// At least minDigits digits, zero padded
+static void putDigits(TextWriter *w, uint64_t v, unsigned int minDigits) {
+    char digits[20];
+    unsigned int n = 0;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while(v > 0);
+    while(n < minDigits) {
+        digits[n++] = '0';
+    }
+    while(n > 0) {
+        putChar(w, digits[--n]);
+    }
+}
+
+void textWriteUint(TextWriter *w, uint32_t v) {
+    putDigits(w, v, 1);
+}
+
+void textWriteInt(TextWriter *w, int32_t v) {
+    if(v < 0) {
+        putChar(w, '-');
+        putDigits(w, -(int64_t)v, 1);
+    } else {
+        putDigits(w, v, 1);
+    }
+}
+
+void textWriteFixed(TextWriter *w, float v, unsigned char decimals) {
+    if(isnan(v)) {
+        textWriteStr(w, "nan");
+        return;
+    }
+    if(signbit(v)) {
+        putChar(w, '-');
+        v = -v;
+    }
+    if(decimals > TEXT_MAX_DECIMALS) {
+        decimals = TEXT_MAX_DECIMALS;
+    }
+
+    // A float times at most 10^6 is exact in a double, so ties are real ties
+    // and go to even like printf. 1.8e19 is about UINT64_MAX.
+    double scaled = (double)v * powersOf10[decimals];
+    if(isinf(v) || scaled >= 1.8e19) {
+        textWriteStr(w, "inf");
+        return;
+    }
+    uint64_t fixed = (uint64_t)scaled;
+    double rest = scaled - fixed;
+    if(rest > 0.5 || (rest == 0.5 && (fixed & 1))) {
+        fixed++;
+    }
+    putDigits(w, fixed / powersOf10[decimals], 1);
+    if(decimals > 0) {
+        putChar(w, '.');
+        putDigits(w, fixed % powersOf10[decimals], decimals);
+    }
+}
@@ -0,0 +1,28 @@
+/* textwriter.h */
+#ifndef TEXTWRITER_H
+#define TEXTWRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Text payloads written straight into a fixed buffer, without printf. Numbers
+// come out the way "%u", "%d" and "%.<decimals>f" print them. buf is kept NUL
+// terminated, a write that doesn't fit is cut short and sets overflow.
+
+struct TextWriter {
+    char *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;   // Set once a write did not fit
+};
+
+void textWriterInit(TextWriter *w, char *buf, size_t cap);
+void textWriteStr(TextWriter *w, const char *s);
+void textWriteUint(TextWriter *w, uint32_t v);
+void textWriteInt(TextWriter *w, int32_t v);
+
+// Rounded to decimals places (at most 6), nan and inf as printf writes them.
+// Values too large for 64 bits once scaled are written as inf too.
+void textWriteFixed(TextWriter *w, float v, unsigned char decimals);
+
+#endif /* !TEXTWRITER_H */
@@ -0,0 +1,20 @@
+#include "topics.h"
+
+#define TOPIC_DEFINE(name, value) \
+    constexpr decltype(Topics::name) Topics::name; \
+    static_assert(topicValid(Topics::name.s), "Topics::" #name " is not a valid topic");
+#define TOPIC_KEY_DEFINE(key, name) TOPIC_DEFINE(key, TOPIC_FOR_KEY(key, name))
+TOPIC_LIST(TOPIC_DEFINE)
+TELEMETRY_VALUE_KEY_NAMES(TOPIC_KEY_DEFINE)
+#undef TOPIC_KEY_DEFINE
+#undef TOPIC_DEFINE
+
+const char *telemetryTopic(TelemetryKey key) {
+#define TOPIC_CASE(key, name) case key: return Topics::key.s;
+    switch(key) {
+    TELEMETRY_VALUE_KEY_NAMES(TOPIC_CASE)
+    default:
+        return NULL;
+    }
+#undef TOPIC_CASE
+}
@@ -0,0 +1,111 @@
+/* topics.h */
+#ifndef TOPICS_H
+#define TOPICS_H
+
+#include <stddef.h>
+
+#include "config.h"
+#include "telemetry.h"
+
+// Every MQTT topic, built from MQTT_ROOT at compile time. Nothing assembles a
+// topic at run time, the firmware only passes pointers to these constants.
+//
+// HomeAssistant ids are MQTT_ROOT with '/' and '-' turned into '_', so the
+// default "well/monitor" gives "well_monitor" as before. A second monitor on
+// the same broker only needs different build flags, e.g.
+//
+//   -D HOSTNAME='"well-control-2"' -D MQTT_ROOT='"well2/monitor"'
+
+template<size_t N>
+struct TopicString {
+    char s[N];  // NUL terminated
+
+    static constexpr size_t length = N - 1;
+};
+
+// std::index_sequence is C++14, the firmware builds as C++11
+template<size_t... I>
+struct TopicIndex {};
+
+template<size_t N, size_t... I>
+struct TopicIndexFor : TopicIndexFor<N - 1, N - 1, I...> {};
+
+template<size_t... I>
+struct TopicIndexFor<0, I...> {
+    typedef TopicIndex<I...> type;
+};
+
+template<size_t A, size_t B, size_t... I>
+constexpr TopicString<A + B - 1> topicJoin(const char (&a)[A], const char (&b)[B], TopicIndex<I...>) {
+    return {{ (I < A - 1 ? a[I] : b[I - (A - 1)])..., '\0' }};
+}
+
+template<size_t A, size_t B>
+constexpr TopicString<A + B - 1> topicJoin(const char (&a)[A], const char (&b)[B]) {
+    return topicJoin(a, b, typename TopicIndexFor<A + B - 2>::type());
+}
+
+template<size_t A, size_t B, size_t C>
+constexpr TopicString<A + B + C - 2> topicJoin(const char (&a)[A], const char (&b)[B], const char (&c)[C]) {
+    return topicJoin(topicJoin(a, b).s, c);
+}
+
+template<size_t N, size_t... I>
+constexpr TopicString<N> topicId(const char (&a)[N], TopicIndex<I...>) {
+    return {{ (a[I] == '/' || a[I] == '-' ? '_' : a[I])..., '\0' }};
+}
+
+// a with '/' and '-' replaced, for HomeAssistant object and unique ids
+template<size_t N>
+constexpr TopicString<N> topicId(const char (&a)[N]) {
+    return topicId(a, typename TopicIndexFor<N - 1>::type());
+}
+
+// Not empty, no wildcards, no empty levels and no leading or trailing '/'
+constexpr bool topicValid(const char *s, size_t i = 0, char prev = '/') {
+    return s[i] == '\0' ? i > 0 && prev != '/'
+         : s[i] == '+' || s[i] == '#' || (s[i] == '/' && prev == '/') ? false
+         : topicValid(s, i + 1, s[i]);
+}
+
+static_assert(topicValid(MQTT_ROOT), "MQTT_ROOT must be a topic without wildcards or empty levels");
+static_assert(HOSTNAME[0] != '\0', "HOSTNAME is used as the MQTT client id");
+
+constexpr auto HA_NODE_ID = topicId(MQTT_ROOT);
+
+// name, value of every fixed topic
+#define TOPIC_LIST(X) \
+    X(LOG,               topicJoin(MQTT_ROOT, "/log")) \
+    X(TRACE,             topicJoin(MQTT_ROOT, "/trace")) \
+    X(CBOR_STATE,        topicJoin(MQTT_ROOT, "/cbor/state")) \
+    X(CBOR_METRICS,      topicJoin(MQTT_ROOT, "/cbor/metrics")) \
+    X(PUMP_OVERRIDE,     topicJoin(MQTT_ROOT, "/pump/override/set")) \
+    X(HA_STATE,          topicJoin("homeassistant/sensor/", HA_NODE_ID.s, "/state")) \
+    X(HA_SWITCH_SET,     topicJoin("homeassistant/switch/", HA_NODE_ID.s, "/set")) \
+    X(HA_PUMP_CONFIG,    topicJoin("homeassistant/binary_sensor/", HA_NODE_ID.s, "_pump/config")) \
+    X(HA_CURRENT_CONFIG, topicJoin("homeassistant/sensor/", HA_NODE_ID.s, "_pump_current/config")) \
+    X(HA_POWER_CONFIG,   topicJoin("homeassistant/sensor/", HA_NODE_ID.s, "_pump_power/config")) \
+    X(HA_SWITCH_CONFIG,  topicJoin("homeassistant/switch/", HA_NODE_ID.s, "_switch/config")) \
+    X(HA_AUTO_CONFIG,    topicJoin("homeassistant/button/", HA_NODE_ID.s, "_pump_auto/config"))
+
+// The topic of a telemetry value key, Topics::TLM_PUMP_ON is MQTT_ROOT "/pump".
+// The frame header keys are only sent inside CBOR frames and have none.
+#define TOPIC_FOR_KEY(key, name) topicJoin(MQTT_ROOT "/", name)
+
+// Declared here for their lengths and defined once in topics.cpp, so each topic
+// is in flash once however many files publish to it.
+//
+// PUMP_OVERRIDE takes ON, OFF or AUTO, the HomeAssistant Pump Auto button sends AUTO.
+struct Topics {
+#define TOPIC_MEMBER(name, value) static constexpr auto name = value;
+#define TOPIC_KEY_MEMBER(key, name) static constexpr auto key = TOPIC_FOR_KEY(key, name);
+    TOPIC_LIST(TOPIC_MEMBER)
+    TELEMETRY_VALUE_KEY_NAMES(TOPIC_KEY_MEMBER)
+#undef TOPIC_KEY_MEMBER
+#undef TOPIC_MEMBER
+};
+
+// Topics::<key>.s for a key only known at run time, NULL if it has no text topic
+const char *telemetryTopic(TelemetryKey key);
+
+#endif /* !TOPICS_H */
@@ -0,0 +1,135 @@
+#include <math.h>
+
+#include "inrush.h"
+
+bool inrushAnalyse(const PumpConfig *cfg, float offsetMv, const uint16_t *samplesMv, size_t n,
+                   float sampleUs, InrushFeatures *out) {
+    out->peakAmps = 0.0f;
+    out->peakRmsAmps = 0.0f;
+    out->steadyAmps = 0.0f;
+    out->peakRatio = 0.0f;
+    out->onsetMs = 0.0f;
+    out->settleMs = 0.0f;
+    out->started = false;
+    out->settled = false;
+
+    if(sampleUs <= 0.0f) {
+        return false;
+    }
+
+    size_t perCycle = (size_t)(1e6f / (INRUSH_MAINS_HZ * sampleUs) + 0.5f);
+    if(perCycle < 4) {
+        return false;
+    }
+    size_t cycles = n / perCycle;
+    if(cycles > INRUSH_MAX_CYCLES) {
+        cycles = INRUSH_MAX_CYCLES;
+    }
+    if(cycles < INRUSH_STEADY_CYCLES + 2) {
+        return false;
+    }
+
+    // Burden mV to primary amps, as in ctApparentPower()
+    const float ampsPerMv = (float)(cfg->numTurns / cfg->rBurden / 1000.0);
+    const float cycleMs = perCycle * sampleUs / 1000.0f;
+
+    float cycleRms[INRUSH_MAX_CYCLES];
+    float peakMv = 0.0f;
+    for(size_t c = 0; c < cycles; c++) {
+        const uint16_t *x = samplesMv + c * perCycle;
+        float sumSq = 0.0f;
+        for(size_t i = 0; i < perCycle; i++) {
+            float v = x[i] - offsetMv;
+            sumSq += v * v;
+            if(fabsf(v) > peakMv) {
+                peakMv = fabsf(v);
+            }
+        }
+        cycleRms[c] = sqrtf(sumSq / perCycle) * ampsPerMv;
+    }
+
+    size_t onset = 0;
+    while(onset < cycles && cycleRms[onset] < cfg->noiseFloorAmps) {
+        onset++;
+    }
+    if(onset == cycles) {
+        return false;
+    }
+    out->started = true;
+    out->onsetMs = onset * cycleMs;
+
+    // Closing late in the capture leaves nothing to compare against
+    const size_t steadyFrom = cycles - INRUSH_STEADY_CYCLES;
+    if(onset >= steadyFrom) {
+        return false;
+    }
+
+    float steadySq = 0.0f;
+    for(size_t c = steadyFrom; c < cycles; c++) {
+        steadySq += cycleRms[c] * cycleRms[c];
+    }
+    out->steadyAmps = sqrtf(steadySq / INRUSH_STEADY_CYCLES);
+    if(out->steadyAmps < cfg->noiseFloorAmps) {
+        return false;
+    }
+
+    size_t settledAt = onset;
+    for(size_t c = onset; c < cycles; c++) {
+        if(cycleRms[c] > out->peakRmsAmps) {
+            out->peakRmsAmps = cycleRms[c];
+        }
+        if(fabsf(cycleRms[c] - out->steadyAmps) > INRUSH_SETTLE_BAND * out->steadyAmps) {
+            settledAt = c + 1;
+        }
+    }
+
+    out->peakAmps = peakMv * ampsPerMv;
+    out->peakRatio = out->peakRmsAmps / out->steadyAmps;
+    out->settleMs = (settledAt - onset) * cycleMs;
+    out->settled = (settledAt <= steadyFrom);
+    return true;
+}
+
+static const char *trendNames[INRUSH_TREND_COUNT] = {
+    "peak ratio", "settle time", "running current"
+};
+
+// Differences smaller than this never count as drift, e.g. a settle time of
+// 0 against one cycle
+static const float trendFloor[INRUSH_TREND_COUNT] = {
+    1.0f, 1000.0f / INRUSH_MAINS_HZ, 0.5f
+};
+
+const char *inrushTrendName(uint8_t value) {
+    return value < INRUSH_TREND_COUNT ? trendNames[value] : "?";
+}
+
+void inrushTrendInit(InrushTrend *trend) {
+    trend->starts = 0;
+    for(int v = 0; v < INRUSH_TREND_COUNT; v++) {
+        trend->baseline[v] = 0.0f;
+        trend->recent[v] = 0.0f;
+    }
+}
+
+uint8_t inrushTrendUpdate(InrushTrend *trend, const InrushFeatures *f) {
+    const float x[INRUSH_TREND_COUNT] = { f->peakRatio, f->settleMs, f->steadyAmps };
+
+    // A plain mean until the window is full, then an exponential average
+    trend->starts++;
+    uint32_t slow = trend->starts < INRUSH_TREND_SLOW ? trend->starts : INRUSH_TREND_SLOW;
+    uint32_t fast = trend->starts < INRUSH_TREND_FAST ? trend->starts : INRUSH_TREND_FAST;
+
+    uint8_t drift = 0;
+    for(int v = 0; v < INRUSH_TREND_COUNT; v++) {
+        trend->baseline[v] += (x[v] - trend->baseline[v]) / slow;
+        trend->recent[v] += (x[v] - trend->recent[v]) / fast;
+
+        float scale = fmaxf(fabsf(trend->baseline[v]), trendFloor[v]);
+        if(trend->starts >= INRUSH_TREND_MIN_STARTS &&
+           fabsf(trend->recent[v] - trend->baseline[v]) > INRUSH_DRIFT_FRACTION * scale) {
+            drift |= 1 << v;
+        }
+    }
+    return drift;
+}
@@ -0,0 +1,66 @@
+/* inrush.h */
+#ifndef INRUSH_H
+#define INRUSH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "pumplogic.h"
+
+// Start-up current of the motor, captured at a high sample rate right after
+// the relay closes. The capture is cut into mains cycles and each cycle's RMS
+// current is compared with the steady running current at the end of it.
+
+#ifndef INRUSH_MAINS_HZ
+#define INRUSH_MAINS_HZ 60
+#endif
+#define INRUSH_MAX_CYCLES 64      // Cycles analysed, the rest of a longer capture is ignored
+#define INRUSH_STEADY_CYCLES 6    // Cycles at the end of the capture that make up the running current
+#define INRUSH_SETTLE_BAND 0.10f  // Settled once every cycle RMS is within 10% of running current
+
+struct InrushFeatures {
+    float peakAmps;       // Largest instantaneous current
+    float peakRmsAmps;    // Largest single cycle RMS current
+    float steadyAmps;     // RMS current over the last INRUSH_STEADY_CYCLES cycles
+    float peakRatio;      // peakRmsAmps / steadyAmps
+    float onsetMs;        // First cycle above the noise floor, from the start of the capture
+    float settleMs;       // From onset to the end of the last cycle outside INRUSH_SETTLE_BAND
+    bool started;         // Current rose above the noise floor during the capture
+    bool settled;         // Settled before the steady cycles, otherwise settleMs runs to the end
+};
+
+// Extract the features from n readings in mV taken sampleUs apart. offsetMv is
+// the DC bias on the CT input, e.g. from the DcTracker before the relay closed.
+// Returns false if the motor didn't start or the capture is too short to tell.
+bool inrushAnalyse(const PumpConfig *cfg, float offsetMv, const uint16_t *samplesMv, size_t n,
+                   float sampleUs, InrushFeatures *out);
+
+// Trended features, one slow and one fast average per start. The slow one is
+// the motor's baseline, the fast one follows the last few starts and a drift
+// is flagged when they part by more than INRUSH_DRIFT_FRACTION.
+enum InrushTrendValue {
+    INRUSH_TREND_PEAK_RATIO,
+    INRUSH_TREND_SETTLE_MS,
+    INRUSH_TREND_STEADY_AMPS,
+    INRUSH_TREND_COUNT
+};
+
+#define INRUSH_TREND_SLOW 64          // Starts the baseline averages over
+#define INRUSH_TREND_FAST 8           // Starts the recent average follows
+#define INRUSH_TREND_MIN_STARTS 32    // No drift is flagged until the baseline has this many
+#define INRUSH_DRIFT_FRACTION 0.20f
+
+struct InrushTrend {
+    uint32_t starts;
+    float baseline[INRUSH_TREND_COUNT];
+    float recent[INRUSH_TREND_COUNT];
+};
+
+void inrushTrendInit(InrushTrend *trend);
+
+// Add a start, returns a bit (1 << InrushTrendValue) for every value that drifted
+uint8_t inrushTrendUpdate(InrushTrend *trend, const InrushFeatures *f);
+
+const char *inrushTrendName(uint8_t value);
+
+#endif /* !INRUSH_H */
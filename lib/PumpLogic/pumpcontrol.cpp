@@ -0,0 +1,212 @@
+#include "pumpcontrol.h"
+
+#define T(next, guard, action) { next, PUMP_GUARD_##guard, PUMP_ACT_##action }
+#define STAY(state) T(state, NONE, NONE)
+
+// Manual commands are accepted in every state, but a pending backoff stays in
+// force through manual mode: ON is refused until it expires and a release
+// goes back through PUMP_BACKOFF, which hands over to idle on the next tick
+// once it has expired. A dry run stops the pump straight away, in manual too,
+// everything else waits for the minimum run or rest time.
+const PumpTransition pumpTransitions[PUMP_STATE_COUNT][PUMP_EVENT_COUNT] = {
+    /* PUMP_IDLE */ {
+        /* DEMAND         */ T(PUMP_STARTING, MIN_REST, NONE),
+        /* NO_DEMAND      */ STAY(PUMP_IDLE),
+        /* POWER_OK       */ STAY(PUMP_IDLE),
+        /* POWER_BAD      */ STAY(PUMP_IDLE),
+        /* POWER_BAD_LIMIT*/ STAY(PUMP_IDLE),
+        /* TICK           */ STAY(PUMP_IDLE),
+        /* MANUAL_ON      */ T(PUMP_MANUAL, NONE, MANUAL_ON),
+        /* MANUAL_OFF     */ T(PUMP_MANUAL, NONE, MANUAL_OFF),
+        /* MANUAL_RELEASE */ STAY(PUMP_IDLE)
+    },
+    /* PUMP_STARTING */ {
+        /* DEMAND         */ STAY(PUMP_STARTING),
+        /* NO_DEMAND      */ T(PUMP_IDLE, MIN_RUN, NONE),
+        /* POWER_OK       */ T(PUMP_RUNNING, NONE, NONE),
+        /* POWER_BAD      */ T(PUMP_SUSPECT, NONE, NONE),
+        /* POWER_BAD_LIMIT*/ T(PUMP_BACKOFF, NONE, START_BACKOFF),
+        /* TICK           */ STAY(PUMP_STARTING),
+        /* MANUAL_ON      */ T(PUMP_MANUAL, NONE, MANUAL_ON),
+        /* MANUAL_OFF     */ T(PUMP_MANUAL, NONE, MANUAL_OFF),
+        /* MANUAL_RELEASE */ STAY(PUMP_STARTING)
+    },
+    /* PUMP_RUNNING */ {
+        /* DEMAND         */ STAY(PUMP_RUNNING),
+        /* NO_DEMAND      */ T(PUMP_IDLE, MIN_RUN, NONE),
+        /* POWER_OK       */ STAY(PUMP_RUNNING),
+        /* POWER_BAD      */ T(PUMP_SUSPECT, NONE, NONE),
+        /* POWER_BAD_LIMIT*/ T(PUMP_BACKOFF, NONE, START_BACKOFF),
+        /* TICK           */ STAY(PUMP_RUNNING),
+        /* MANUAL_ON      */ T(PUMP_MANUAL, NONE, MANUAL_ON),
+        /* MANUAL_OFF     */ T(PUMP_MANUAL, NONE, MANUAL_OFF),
+        /* MANUAL_RELEASE */ STAY(PUMP_RUNNING)
+    },
+    /* PUMP_SUSPECT */ {
+        /* DEMAND         */ STAY(PUMP_SUSPECT),
+        /* NO_DEMAND      */ T(PUMP_IDLE, MIN_RUN, NONE),
+        /* POWER_OK       */ T(PUMP_RUNNING, NONE, NONE),
+        /* POWER_BAD      */ STAY(PUMP_SUSPECT),
+        /* POWER_BAD_LIMIT*/ T(PUMP_BACKOFF, NONE, START_BACKOFF),
+        /* TICK           */ STAY(PUMP_SUSPECT),
+        /* MANUAL_ON      */ T(PUMP_MANUAL, NONE, MANUAL_ON),
+        /* MANUAL_OFF     */ T(PUMP_MANUAL, NONE, MANUAL_OFF),
+        /* MANUAL_RELEASE */ STAY(PUMP_SUSPECT)
+    },
+    /* PUMP_BACKOFF */ {
+        /* DEMAND         */ STAY(PUMP_BACKOFF),
+        /* NO_DEMAND      */ STAY(PUMP_BACKOFF),
+        /* POWER_OK       */ STAY(PUMP_BACKOFF),
+        /* POWER_BAD      */ STAY(PUMP_BACKOFF),
+        /* POWER_BAD_LIMIT*/ STAY(PUMP_BACKOFF),
+        /* TICK           */ T(PUMP_IDLE, BACKOFF_EXPIRED, NONE),
+        /* MANUAL_ON      */ STAY(PUMP_BACKOFF),
+        /* MANUAL_OFF     */ T(PUMP_MANUAL, NONE, MANUAL_OFF),
+        /* MANUAL_RELEASE */ STAY(PUMP_BACKOFF)
+    },
+    /* PUMP_MANUAL */ {
+        /* DEMAND         */ STAY(PUMP_MANUAL),
+        /* NO_DEMAND      */ STAY(PUMP_MANUAL),
+        /* POWER_OK       */ STAY(PUMP_MANUAL),
+        /* POWER_BAD      */ STAY(PUMP_MANUAL),
+        /* POWER_BAD_LIMIT*/ T(PUMP_BACKOFF, NONE, START_BACKOFF),
+        /* TICK           */ STAY(PUMP_MANUAL),
+        /* MANUAL_ON      */ T(PUMP_MANUAL, BACKOFF_EXPIRED, MANUAL_ON),
+        /* MANUAL_OFF     */ T(PUMP_MANUAL, NONE, MANUAL_OFF),
+        /* MANUAL_RELEASE */ T(PUMP_BACKOFF, NONE, NONE)
+    }
+};
+
+#undef STAY
+#undef T
+
+static const char *stateNames[PUMP_STATE_COUNT] = {
+    "idle", "starting", "running", "suspect", "backoff", "manual"
+};
+
+static const char *eventNames[PUMP_EVENT_COUNT] = {
+    "demand", "no-demand", "power-ok", "power-bad", "power-bad-limit",
+    "tick", "manual-on", "manual-off", "manual-release"
+};
+
+const char *pumpStateName(uint8_t state) {
+    return state < PUMP_STATE_COUNT ? stateNames[state] : "?";
+}
+
+const char *pumpEventName(uint8_t event) {
+    return event < PUMP_EVENT_COUNT ? eventNames[event] : "?";
+}
+
+static bool relayFor(const PumpController *ctl, uint8_t state) {
+    switch(state) {
+    case PUMP_STARTING:
+    case PUMP_RUNNING:
+    case PUMP_SUSPECT:
+        return true;
+    case PUMP_MANUAL:
+        return ctl->manualRelay;
+    default:
+        return false;
+    }
+}
+
+// Compare as signed so millis() wrapping is harmless
+static bool elapsed(uint32_t since, uint32_t nowMs, uint32_t ms) {
+    return (int32_t)(nowMs - since - ms) >= 0;
+}
+
+static bool guardHolds(const PumpController *ctl, uint8_t guard, uint32_t nowMs) {
+    switch(guard) {
+    case PUMP_GUARD_MIN_RUN:
+        return elapsed(ctl->relayChangedMs, nowMs, ctl->cfg->minRunMs);
+    case PUMP_GUARD_MIN_REST:
+        return elapsed(ctl->relayChangedMs, nowMs, ctl->cfg->minRestMs);
+    case PUMP_GUARD_BACKOFF_EXPIRED:
+        return (int32_t)(nowMs - ctl->backoffUntilMs) >= 0;
+    default:
+        return true;
+    }
+}
+
+void pumpControlInit(PumpController *ctl, const PumpConfig *cfg, uint32_t nowMs) {
+    ctl->cfg = cfg;
+    ctl->state = PUMP_IDLE;
+    ctl->relay = false;
+    ctl->manualRelay = false;
+    ctl->relayChangedMs = nowMs - cfg->minRestMs;
+    ctl->backoffUntilMs = nowMs;
+    ctl->logCount = 0;
+}
+
+bool pumpControlEvent(PumpController *ctl, PumpEvent event, uint32_t nowMs) {
+    if(event >= PUMP_EVENT_COUNT) {
+        return false;
+    }
+
+    const PumpTransition *t = &pumpTransitions[ctl->state][event];
+    if(!guardHolds(ctl, t->guard, nowMs)) {
+        return false;
+    }
+
+    switch(t->action) {
+    case PUMP_ACT_START_BACKOFF:
+        ctl->backoffUntilMs = nowMs + ctl->cfg->backoffMs;
+        break;
+    case PUMP_ACT_MANUAL_ON:
+        ctl->manualRelay = true;
+        break;
+    case PUMP_ACT_MANUAL_OFF:
+        ctl->manualRelay = false;
+        break;
+    }
+
+    uint8_t from = ctl->state;
+    ctl->state = t->next;
+
+    bool relay = relayFor(ctl, ctl->state);
+    bool relayChanged = (relay != ctl->relay);
+    if(relayChanged) {
+        ctl->relay = relay;
+        ctl->relayChangedMs = nowMs;
+    }
+
+    // Manual ON/OFF flips the relay without leaving PUMP_MANUAL, log those too
+    if(from == ctl->state && !relayChanged) {
+        return false;
+    }
+
+    PumpTransitionRecord *r = &ctl->log[ctl->logCount % PUMP_LOG_SIZE];
+    r->timeMs = nowMs;
+    r->from = from;
+    r->to = ctl->state;
+    r->event = event;
+    ctl->logCount++;
+    return true;
+}
+
+void pumpControlStep(PumpController *ctl, State *state, uint32_t nowMs) {
+    const PumpConfig *cfg = ctl->cfg;
+    const float p = state->power;
+
+    // The power reading was taken under the previous relay state so it goes in
+    // before the request, otherwise a start would be judged on a reading taken
+    // with the relay still open.
+    if(p >= cfg->badLoadWattsLow && p <= cfg->badLoadWattsHigh) {
+        state->pumpNotOkCount++;
+        state->pumpOk = false;
+        pumpControlEvent(ctl, state->pumpNotOkCount >= cfg->notOkLimit ? PUMP_EV_POWER_BAD_LIMIT : PUMP_EV_POWER_BAD, nowMs);
+    } else {
+        state->pumpNotOkCount = 0;
+        state->pumpOk = true;
+        pumpControlEvent(ctl, PUMP_EV_POWER_OK, nowMs);
+    }
+
+    // req1/req2 hold the raw pin levels, LOW is a request for water
+    pumpControlEvent(ctl, (state->req1 && state->req2) ? PUMP_EV_NO_DEMAND : PUMP_EV_DEMAND, nowMs);
+    pumpControlEvent(ctl, PUMP_EV_TICK, nowMs);
+
+    state->pumpState = ctl->state;
+    state->pumpOn = ctl->relay;
+    state->backoff = (ctl->state == PUMP_BACKOFF);
+    state->backoffTimeoutSeconds = state->backoff ? (ctl->backoffUntilMs - nowMs) / 1000 : 0;
+}
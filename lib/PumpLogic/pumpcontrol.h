@@ -0,0 +1,93 @@
+/* pumpcontrol.h */
+#ifndef PUMPCONTROL_H
+#define PUMPCONTROL_H
+
+#include <stdint.h>
+
+#include "pumplogic.h"
+#include "state.h"
+
+// Pump control state machine. Every decision is one lookup in
+// pumpTransitions[state][event] plus an optional guard and action, so the
+// cost per event is constant and the whole table can be walked on the host.
+
+enum PumpState {
+    PUMP_IDLE,        // Relay open, no request or resting
+    PUMP_STARTING,    // Relay closed, no power reading taken while running yet
+    PUMP_RUNNING,     // Relay closed, power outside the dry-run band
+    PUMP_SUSPECT,     // Relay closed, power in the dry-run band below notOkLimit
+    PUMP_BACKOFF,     // Relay open until backoffMs has passed
+    PUMP_MANUAL,      // Relay follows the override until released
+    PUMP_STATE_COUNT
+};
+
+enum PumpEvent {
+    PUMP_EV_DEMAND,          // A water request is active
+    PUMP_EV_NO_DEMAND,       // No water request
+    PUMP_EV_POWER_OK,        // Power reading outside the dry-run band
+    PUMP_EV_POWER_BAD,       // Power reading in the dry-run band
+    PUMP_EV_POWER_BAD_LIMIT, // notOkLimit consecutive readings in the band
+    PUMP_EV_TICK,            // Time passed
+    PUMP_EV_MANUAL_ON,
+    PUMP_EV_MANUAL_OFF,
+    PUMP_EV_MANUAL_RELEASE,
+    PUMP_EVENT_COUNT
+};
+
+enum PumpGuard {
+    PUMP_GUARD_NONE,
+    PUMP_GUARD_MIN_RUN,          // Relay has been closed for minRunMs
+    PUMP_GUARD_MIN_REST,         // Relay has been open for minRestMs
+    PUMP_GUARD_BACKOFF_EXPIRED
+};
+
+enum PumpAction {
+    PUMP_ACT_NONE,
+    PUMP_ACT_START_BACKOFF,
+    PUMP_ACT_MANUAL_ON,
+    PUMP_ACT_MANUAL_OFF
+};
+
+struct PumpTransition {
+    uint8_t next;     // PumpState, taken only if the guard holds
+    uint8_t guard;    // PumpGuard
+    uint8_t action;   // PumpAction, run when the transition is taken
+};
+
+extern const PumpTransition pumpTransitions[PUMP_STATE_COUNT][PUMP_EVENT_COUNT];
+
+struct PumpTransitionRecord {
+    uint32_t timeMs;
+    uint8_t from;
+    uint8_t to;
+    uint8_t event;
+};
+
+#define PUMP_LOG_SIZE 16  // Transitions kept, oldest are overwritten
+
+struct PumpController {
+    const PumpConfig *cfg;
+    uint8_t state;
+    bool relay;               // Relay output for the current state
+    bool manualRelay;         // Relay output in PUMP_MANUAL
+    uint32_t relayChangedMs;  // When relay last changed
+    uint32_t backoffUntilMs;
+
+    PumpTransitionRecord log[PUMP_LOG_SIZE];
+    uint32_t logCount;        // Changes ever logged, log index is logCount % PUMP_LOG_SIZE
+};
+
+// Starts idle with the rest period already served
+void pumpControlInit(PumpController *ctl, const PumpConfig *cfg, uint32_t nowMs);
+
+// Feed one event, returns true if the state or the relay changed
+bool pumpControlEvent(PumpController *ctl, PumpEvent event, uint32_t nowMs);
+
+// Feed one poll worth of events derived from state (power, water requests)
+// in a fixed order, then copy the outcome back into state
+void pumpControlStep(PumpController *ctl, State *state, uint32_t nowMs);
+
+const char *pumpStateName(uint8_t state);
+const char *pumpEventName(uint8_t event);
+
+#endif /* !PUMPCONTROL_H */
@@ -0,0 +1,84 @@
+#include <math.h>
+
+#include "pumplogic.h"
+
+const PumpConfig pumpConfigDefault = {
+    120.0,      // vRMS
+    1.644,      // offset
+    2000.0,     // numTurns
+    200.0,      // rBurden
+    0.2,        // noiseFloorAmps, ignore noise below 200mA
+    1000.0,     // badLoadWattsLow
+    1500.0,     // badLoadWattsHigh
+    3,          // notOkLimit
+    7200000,    // backoffMs, two hours
+    60000,      // minRunMs
+    120000      // minRestMs
+};
+
+void dcTrackerInit(DcTracker *dc, const PumpConfig *cfg) {
+    dc->biasQ16 = (int32_t)(cfg->offset * 1000.0 * 65536.0);
+    dc->seeded = false;
+}
+
+void dcTrackerRestore(DcTracker *dc, int32_t biasQ16) {
+    dc->biasQ16 = biasQ16;
+    dc->seeded = true;
+}
+
+double dcTrackerVolts(const DcTracker *dc) {
+    return dc->biasQ16 / 65536.0 / 1000.0;
+}
+
+double ctApparentPower(const PumpConfig *cfg, DcTracker *dc, const uint16_t *samplesMv, size_t n, State *state) {
+    double iRMS = 0.0;
+
+    if(n > 0) {
+        // Integer sums only inside the loop, samples are at most 12 bits of mV
+        int64_t sum = 0;
+        uint64_t sumSq = 0;
+        for(size_t i = 0; i < n; i++) {
+            uint32_t x = samplesMv[i];
+            sum += x;
+            sumSq += x * x;
+        }
+
+        // Track the DC bias (offset applied by a voltage divider in the circuit
+        // between shield and ground). A window rarely holds a whole number of
+        // mains cycles so its mean is only averaged in, except for the first one.
+        int32_t meanQ16 = (int32_t)((sum << 16) / (int64_t)n);
+        if(dc->seeded) {
+            dc->biasQ16 += (meanQ16 - dc->biasQ16) >> DC_TRACK_SHIFT;
+        } else {
+            dc->biasQ16 = meanQ16;
+            dc->seeded = true;
+        }
+
+        // Sum of (x - bias)^2 expanded so the bias is removed once per window
+        double b = dc->biasQ16 / 65536.0;
+        double acc = (double)sumSq - 2.0 * b * (double)sum + (double)n * b * b;
+        if(acc < 0.0) {
+            acc = 0.0;
+        }
+
+        // RMS of the burden voltage in V, then secondary and primary current
+        double vRMSBurden = sqrt(acc / n) / 1000.0;
+        iRMS = vRMSBurden / cfg->rBurden * cfg->numTurns;
+    }
+
+    if(iRMS < cfg->noiseFloorAmps) {
+        iRMS = 0.0;
+    }
+
+    // Calculate apparent power
+    double apparentPower = cfg->vRMS * iRMS;
+
+    state->voltage = cfg->vRMS;
+    state->current = iRMS;
+    state->power = apparentPower;
+
+    // realPowerWatts = apparentPowerVoltAmps * powerFactor
+    // (probably a wash in regards to the power factor of the well pump)
+
+    return apparentPower;
+}
@@ -0,0 +1,52 @@
+/* pumplogic.h */
+#ifndef PUMPLOGIC_H
+#define PUMPLOGIC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "state.h"
+
+// Hardware independent half of the readCTApparentPower -> resolveState
+// pipeline. The firmware does the ADC capture and drives the pins,
+// everything that decides what to do lives here (and in pumpcontrol.h) so
+// it can also be replayed on the host.
+
+struct PumpConfig {
+    double vRMS;             // Assumed or measured
+    double offset;           // Nominal DC offset in Volts, the tracker starts here
+    double numTurns;         // 1:2000 transformer turns
+    double rBurden;          // Burden resistor value in Ohms
+    double noiseFloorAmps;   // RMS current below this is reported as 0
+    float badLoadWattsLow;   // Power band where the pump is sucking air
+    float badLoadWattsHigh;
+    unsigned int notOkLimit; // Consecutive bad readings before backing off
+    uint32_t backoffMs;      // How long the pump stays off once backed off
+    uint32_t minRunMs;       // Shortest run before a lost request may stop the pump
+    uint32_t minRestMs;      // Shortest rest before a request may restart it
+};
+
+extern const PumpConfig pumpConfigDefault;
+
+// Each capture window moves the DC estimate 1/2^DC_TRACK_SHIFT of the way to its mean
+#define DC_TRACK_SHIFT 3
+
+// Running estimate of the DC bias the voltage divider puts on the CT signal
+struct DcTracker {
+    int32_t biasQ16;   // Bias in mV, Q16.16 fixed point
+    bool seeded;       // False until a window has been seen or an estimate restored
+};
+
+void dcTrackerInit(DcTracker *dc, const PumpConfig *cfg);
+
+// Start from a persisted estimate, e.g. after a warm boot
+void dcTrackerRestore(DcTracker *dc, int32_t biasQ16);
+
+double dcTrackerVolts(const DcTracker *dc);
+
+// Calculate RMS current and apparent power from a block of ADC readings in mV
+// and store them in state. The DC bias is tracked across windows and removed
+// from each one. Returns apparent power.
+double ctApparentPower(const PumpConfig *cfg, DcTracker *dc, const uint16_t *samplesMv, size_t n, State *state);
+
+#endif /* !PUMPLOGIC_H */
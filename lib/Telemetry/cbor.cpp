@@ -0,0 +1,261 @@
+#include <string.h>
+
+#include "cbor.h"
+
+#define CBOR_MAJOR_UINT   0
+#define CBOR_MAJOR_NEGINT 1
+#define CBOR_MAJOR_TEXT   3
+#define CBOR_MAJOR_ARRAY  4
+#define CBOR_MAJOR_MAP    5
+#define CBOR_MAJOR_SIMPLE 7
+
+void cborWriterInit(CborWriter *w, uint8_t *buf, size_t cap) {
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->overflow = false;
+}
+
+static void put(CborWriter *w, const uint8_t *p, size_t n) {
+    if(w->len + n > w->cap) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, p, n);
+    w->len += n;
+}
+
+// Major type plus argument in the shortest form
+static void putHead(CborWriter *w, uint8_t major, uint32_t v) {
+    uint8_t b[5];
+    major <<= 5;
+
+    if(v < 24) {
+        b[0] = major | v;
+        put(w, b, 1);
+    } else if(v <= 0xFF) {
+        b[0] = major | 24;
+        b[1] = v;
+        put(w, b, 2);
+    } else if(v <= 0xFFFF) {
+        b[0] = major | 25;
+        b[1] = v >> 8;
+        b[2] = v & 0xFF;
+        put(w, b, 3);
+    } else {
+        b[0] = major | 26;
+        b[1] = v >> 24;
+        b[2] = (v >> 16) & 0xFF;
+        b[3] = (v >> 8) & 0xFF;
+        b[4] = v & 0xFF;
+        put(w, b, 5);
+    }
+}
+
+void cborWriteUint(CborWriter *w, uint32_t v) {
+    putHead(w, CBOR_MAJOR_UINT, v);
+}
+
+void cborWriteInt(CborWriter *w, int32_t v) {
+    if(v >= 0) {
+        putHead(w, CBOR_MAJOR_UINT, v);
+    } else {
+        putHead(w, CBOR_MAJOR_NEGINT, (uint32_t)(-1 - v));
+    }
+}
+
+void cborWriteBool(CborWriter *w, bool v) {
+    uint8_t b = (CBOR_MAJOR_SIMPLE << 5) | (v ? 21 : 20);
+    put(w, &b, 1);
+}
+
+void cborWriteNull(CborWriter *w) {
+    uint8_t b = (CBOR_MAJOR_SIMPLE << 5) | 22;
+    put(w, &b, 1);
+}
+
+// Half float bits if v converts exactly, 0xFFFFFFFF otherwise
+static uint32_t toHalf(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exp = (bits >> 23) & 0xFF;
+    uint32_t mant = bits & 0x7FFFFF;
+
+    if(exp == 0 && mant == 0) {
+        return sign;
+    }
+    // Normal halves only, the low 13 mantissa bits have to be zero
+    exp = exp - 127 + 15;
+    if(exp <= 0 || exp >= 31 || (mant & 0x1FFF)) {
+        return 0xFFFFFFFF;
+    }
+    return sign | (exp << 10) | (mant >> 13);
+}
+
+static float fromHalf(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1F;
+    uint32_t mant = h & 0x3FF;
+    uint32_t bits;
+
+    if(exp == 0) {
+        if(mant == 0) {
+            bits = sign;
+        } else {
+            // Subnormal, normalise into a single float
+            exp = 127 - 15 + 1;
+            while(!(mant & 0x400)) {
+                mant <<= 1;
+                exp--;
+            }
+            bits = sign | (exp << 23) | ((mant & 0x3FF) << 13);
+        }
+    } else if(exp == 31) {
+        bits = sign | 0x7F800000 | (mant << 13);
+    } else {
+        bits = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+    }
+
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+void cborWriteFloat(CborWriter *w, float v) {
+    uint8_t b[5];
+    uint32_t half = toHalf(v);
+
+    if(half != 0xFFFFFFFF) {
+        b[0] = (CBOR_MAJOR_SIMPLE << 5) | 25;
+        b[1] = half >> 8;
+        b[2] = half & 0xFF;
+        put(w, b, 3);
+        return;
+    }
+
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    b[0] = (CBOR_MAJOR_SIMPLE << 5) | 26;
+    b[1] = bits >> 24;
+    b[2] = (bits >> 16) & 0xFF;
+    b[3] = (bits >> 8) & 0xFF;
+    b[4] = bits & 0xFF;
+    put(w, b, 5);
+}
+
+void cborWriteText(CborWriter *w, const char *s) {
+    size_t n = strlen(s);
+    putHead(w, CBOR_MAJOR_TEXT, n);
+    put(w, (const uint8_t *)s, n);
+}
+
+void cborWriteArray(CborWriter *w, uint32_t n) {
+    putHead(w, CBOR_MAJOR_ARRAY, n);
+}
+
+void cborWriteMap(CborWriter *w, uint32_t n) {
+    putHead(w, CBOR_MAJOR_MAP, n);
+}
+
+void cborReaderInit(CborReader *r, const uint8_t *buf, size_t len) {
+    r->buf = buf;
+    r->len = len;
+    r->pos = 0;
+}
+
+static bool getArg(CborReader *r, uint8_t info, uint64_t *v) {
+    size_t n;
+    if(info < 24) {
+        *v = info;
+        return true;
+    } else if(info == 24) {
+        n = 1;
+    } else if(info == 25) {
+        n = 2;
+    } else if(info == 26) {
+        n = 4;
+    } else if(info == 27) {
+        n = 8;
+    } else {
+        return false;   // Indefinite lengths are not used by the schema
+    }
+
+    if(r->pos + n > r->len) {
+        return false;
+    }
+    *v = 0;
+    for(size_t i = 0; i < n; i++) {
+        *v = (*v << 8) | r->buf[r->pos++];
+    }
+    return true;
+}
+
+bool cborRead(CborReader *r, CborItem *item) {
+    item->type = CBOR_INVALID;
+    if(r->pos >= r->len) {
+        return false;
+    }
+
+    uint8_t head = r->buf[r->pos++];
+    uint8_t major = head >> 5;
+    uint8_t info = head & 0x1F;
+    uint64_t v;
+
+    if(major == CBOR_MAJOR_SIMPLE) {
+        if(info == 20 || info == 21) {
+            item->type = CBOR_BOOL;
+            item->b = (info == 21);
+            return true;
+        }
+        if(info == 22) {
+            item->type = CBOR_NULL;
+            return true;
+        }
+        if((info == 25 || info == 26) && getArg(r, info, &v)) {
+            item->type = CBOR_FLOAT;
+            if(info == 25) {
+                item->f = fromHalf((uint16_t)v);
+            } else {
+                uint32_t bits = (uint32_t)v;
+                memcpy(&item->f, &bits, sizeof(item->f));
+            }
+            return true;
+        }
+        return false;
+    }
+
+    if(!getArg(r, info, &v)) {
+        return false;
+    }
+
+    switch(major) {
+    case CBOR_MAJOR_UINT:
+        item->type = CBOR_UINT;
+        item->i = (int64_t)v;
+        return true;
+    case CBOR_MAJOR_NEGINT:
+        item->type = CBOR_NEGINT;
+        item->i = -1 - (int64_t)v;
+        return true;
+    case CBOR_MAJOR_TEXT:
+        if(r->pos + v > r->len) {
+            return false;
+        }
+        item->type = CBOR_TEXT;
+        item->count = (uint32_t)v;
+        item->text = (const char *)r->buf + r->pos;
+        r->pos += v;
+        return true;
+    case CBOR_MAJOR_ARRAY:
+        item->type = CBOR_ARRAY;
+        item->count = (uint32_t)v;
+        return true;
+    case CBOR_MAJOR_MAP:
+        item->type = CBOR_MAP;
+        item->count = (uint32_t)v;
+        return true;
+    }
+    return false;
+}
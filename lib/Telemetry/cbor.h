@@ -0,0 +1,64 @@
+/* cbor.h */
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Minimal CBOR (RFC 8949) writer and reader for telemetry frames. Only the
+// types the telemetry schema uses: integers, floats, booleans, text, arrays
+// and maps of definite length.
+
+struct CborWriter {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;   // Set once a write did not fit
+};
+
+void cborWriterInit(CborWriter *w, uint8_t *buf, size_t cap);
+void cborWriteUint(CborWriter *w, uint32_t v);
+void cborWriteInt(CborWriter *w, int32_t v);
+void cborWriteBool(CborWriter *w, bool v);
+void cborWriteNull(CborWriter *w);
+
+// Written as a half float when that is exact, otherwise as a single float
+void cborWriteFloat(CborWriter *w, float v);
+
+void cborWriteText(CborWriter *w, const char *s);
+void cborWriteArray(CborWriter *w, uint32_t n);
+void cborWriteMap(CborWriter *w, uint32_t n);
+
+enum CborType {
+    CBOR_UINT,
+    CBOR_NEGINT,
+    CBOR_TEXT,
+    CBOR_ARRAY,
+    CBOR_MAP,
+    CBOR_BOOL,
+    CBOR_NULL,
+    CBOR_FLOAT,
+    CBOR_INVALID
+};
+
+struct CborItem {
+    CborType type;
+    uint32_t count;      // Array/map length or text length
+    int64_t i;           // CBOR_UINT, CBOR_NEGINT
+    float f;             // CBOR_FLOAT
+    bool b;              // CBOR_BOOL
+    const char *text;    // CBOR_TEXT, not NUL terminated
+};
+
+struct CborReader {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+};
+
+void cborReaderInit(CborReader *r, const uint8_t *buf, size_t len);
+
+// Read the next item header, returns false at the end of input or on an unsupported item
+bool cborRead(CborReader *r, CborItem *item);
+
+#endif /* !CBOR_H */
@@ -0,0 +1,100 @@
+#include "telemetry.h"
+#include "cbor.h"
+
+struct KeyName {
+    uint8_t key;
+    const char *name;
+};
+
+#define KEY_NAME(key, name) { key, name },
+static const KeyName keyNames[] = {
+    TELEMETRY_KEY_NAMES(KEY_NAME)
+};
+#undef KEY_NAME
+
+const char *telemetryKeyName(uint32_t key) {
+    for(size_t i = 0; i < sizeof(keyNames) / sizeof(keyNames[0]); i++) {
+        if(keyNames[i].key == key) {
+            return keyNames[i].name;
+        }
+    }
+    return NULL;
+}
+
+static void writeHeader(CborWriter *w, uint32_t entries, TelemetryFrame frame, uint32_t timeMs) {
+    cborWriteMap(w, entries + 3);
+    cborWriteUint(w, TLM_SCHEMA);
+    cborWriteUint(w, TELEMETRY_SCHEMA);
+    cborWriteUint(w, TLM_FRAME);
+    cborWriteUint(w, frame);
+    cborWriteUint(w, TLM_TIME_MS);
+    cborWriteUint(w, timeMs);
+}
+
+size_t telemetryEncodeState(const State *state, uint32_t timeMs, uint8_t *out, size_t cap) {
+    CborWriter w;
+    cborWriterInit(&w, out, cap);
+
+    writeHeader(&w, 11, TLM_FRAME_STATE, timeMs);
+    cborWriteUint(&w, TLM_PUMP_ON);
+    cborWriteBool(&w, state->pumpOn);
+    cborWriteUint(&w, TLM_BACKOFF);
+    cborWriteBool(&w, state->backoff);
+    cborWriteUint(&w, TLM_PUMP_OK);
+    cborWriteBool(&w, state->pumpOk);
+    cborWriteUint(&w, TLM_PUMP_NOT_OK_COUNT);
+    cborWriteUint(&w, state->pumpNotOkCount);
+
+    // Request pins are pulled up, LOW is a request for water
+    cborWriteUint(&w, TLM_WATER_REQUEST_1);
+    cborWriteBool(&w, !state->req1);
+    cborWriteUint(&w, TLM_WATER_REQUEST_2);
+    cborWriteBool(&w, !state->req2);
+
+    cborWriteUint(&w, TLM_MAINS_VOLTS);
+    cborWriteFloat(&w, state->voltage);
+    cborWriteUint(&w, TLM_CURRENT_AMPS);
+    cborWriteFloat(&w, state->current);
+    cborWriteUint(&w, TLM_POWER_WATTS);
+    cborWriteFloat(&w, state->power);
+    cborWriteUint(&w, TLM_BACKOFF_TIMEOUT_S);
+    cborWriteUint(&w, state->backoffTimeoutSeconds);
+    cborWriteUint(&w, TLM_PUMP_STATE);
+    cborWriteUint(&w, state->pumpState);
+
+    return w.overflow ? 0 : w.len;
+}
+
+void metricsFrameInit(MetricsFrame *m) {
+    m->count = 0;
+}
+
+bool metricsFrameAdd(MetricsFrame *m, TelemetryKey key, float value) {
+    for(unsigned int i = 0; i < m->count; i++) {
+        if(m->keys[i] == key) {
+            m->values[i] = value;
+            return true;
+        }
+    }
+
+    if(m->count >= TELEMETRY_MAX_METRICS) {
+        return false;
+    }
+    m->keys[m->count] = key;
+    m->values[m->count] = value;
+    m->count++;
+    return true;
+}
+
+size_t telemetryEncodeMetrics(const MetricsFrame *m, uint32_t timeMs, uint8_t *out, size_t cap) {
+    CborWriter w;
+    cborWriterInit(&w, out, cap);
+
+    writeHeader(&w, m->count, TLM_FRAME_METRICS, timeMs);
+    for(unsigned int i = 0; i < m->count; i++) {
+        cborWriteUint(&w, m->keys[i]);
+        cborWriteFloat(&w, m->values[i]);
+    }
+
+    return w.overflow ? 0 : w.len;
+}
@@ -0,0 +1,187 @@
+/* telemetry.h */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "state.h"
+
+// Binary telemetry frames, shared by the firmware and the host decoder.
+//
+// A frame is a CBOR map with small integer keys:
+//
+//   { TLM_SCHEMA: TELEMETRY_SCHEMA, TLM_FRAME: TelemetryFrame, TLM_TIME_MS: uint,
+//     <key>: <value>, ... }
+//
+// Keys are never reused. New keys get new numbers and decoders skip keys
+// they don't know, so TELEMETRY_SCHEMA only changes when a key's meaning does.
+
+#define TELEMETRY_SCHEMA 1
+
+#define TELEMETRY_FRAME_BYTES 256  // Upper bound of an encoded frame
+#define TELEMETRY_MAX_METRICS 32   // Metrics in one frame
+
+enum TelemetryFrame {
+    TLM_FRAME_STATE   = 0,
+    TLM_FRAME_METRICS = 1
+};
+
+enum TelemetryKey {
+    // Frame header
+    TLM_SCHEMA                = 0,
+    TLM_FRAME                 = 1,
+    TLM_TIME_MS               = 2,
+
+    // State frame
+    TLM_PUMP_ON               = 10,
+    TLM_BACKOFF               = 11,
+    TLM_PUMP_OK               = 12,
+    TLM_PUMP_NOT_OK_COUNT     = 13,
+    TLM_WATER_REQUEST_1       = 14,  // True when water is requested
+    TLM_WATER_REQUEST_2       = 15,
+    TLM_MAINS_VOLTS           = 16,
+    TLM_CURRENT_AMPS          = 17,
+    TLM_POWER_WATTS           = 18,
+    TLM_BACKOFF_TIMEOUT_S     = 19,
+    TLM_PUMP_STATE            = 20,  // PumpState from pumpcontrol.h
+
+    // Metrics frame
+    TLM_CHECK_REQUEST_MS      = 32,
+    TLM_READ_CT_MS            = 33,
+    TLM_HISTORY_BYTES_SAMPLE  = 34,
+    TLM_DC_OFFSET_MV          = 35,
+    TLM_ADC_MV                = 36,
+    TLM_ADC_ADJUSTED_MV       = 37,
+    TLM_ADC_VALUE             = 38,
+    TLM_POWER_ACTIVE_PCT      = 39,
+    TLM_POWER_EST_MA          = 40,
+    TLM_POWER_EST_SAVING_PCT  = 41,
+    TLM_STACK_FREE_POLL       = 42,
+    TLM_STACK_FREE_WIFI       = 43,
+    TLM_STACK_FREE_BLINKER    = 44,
+    TLM_STACK_FREE_LOOP       = 45,
+    TLM_RAM_STATIC_BYTES      = 46,
+    TLM_HEAP_FREE             = 47,
+    TLM_HEAP_MIN_FREE         = 48,
+    TLM_HEAP_LARGEST_BLOCK    = 49,
+    TLM_INRUSH_PEAK_A         = 50,
+    TLM_INRUSH_PEAK_RATIO     = 51,
+    TLM_INRUSH_SETTLE_MS      = 52,
+    TLM_INRUSH_STEADY_A       = 53,
+    TLM_INRUSH_BASELINE_RATIO = 54,
+    TLM_INRUSH_BASELINE_SETTLE_MS = 55,
+    TLM_INRUSH_DRIFT          = 56,  // Bit per InrushTrendValue from inrush.h
+    TLM_INRUSH_SAMPLE_US      = 57,
+    TLM_LOOP_LATENESS_US      = 58,
+    TLM_LOOP_JITTER_US        = 59,
+    TLM_LOOP_EXEC_MS          = 60,
+    TLM_LOOP_DEADLINE_MISSES  = 61,
+    TLM_LOOP_LATENESS_MAX_US  = 62,
+    TLM_LOOP_JITTER_MAX_US    = 63,
+    TLM_LOOP_LATENESS_HIST    = 64,  // LOOP_HIST_BUCKETS keys from here, one per bucket
+    TLM_LOOP_LATENESS_HIST_100US = 64,
+    TLM_LOOP_LATENESS_HIST_1MS   = 65,
+    TLM_LOOP_LATENESS_HIST_10MS  = 66,
+    TLM_LOOP_LATENESS_HIST_100MS = 67,
+    TLM_LOOP_LATENESS_HIST_1S    = 68,
+    TLM_LOOP_LATENESS_HIST_OVER  = 69,
+    TLM_LOOP_JITTER_HIST      = 70,  // Likewise
+    TLM_LOOP_JITTER_HIST_100US = 70,
+    TLM_LOOP_JITTER_HIST_1MS   = 71,
+    TLM_LOOP_JITTER_HIST_10MS  = 72,
+    TLM_LOOP_JITTER_HIST_100MS = 73,
+    TLM_LOOP_JITTER_HIST_1S    = 74,
+    TLM_LOOP_JITTER_HIST_OVER  = 75
+};
+
+// X(key, name) for every key. The value key names are also the text topics
+// under MQTT_ROOT, topics.h builds those from this list at compile time.
+#define TELEMETRY_KEY_NAMES(X) \
+    TELEMETRY_HEADER_KEY_NAMES(X) \
+    TELEMETRY_VALUE_KEY_NAMES(X)
+
+// Frame header keys
+#define TELEMETRY_HEADER_KEY_NAMES(X) \
+    X(TLM_SCHEMA,                    "schema") \
+    X(TLM_FRAME,                     "frame") \
+    X(TLM_TIME_MS,                   "time_ms")
+
+#define TELEMETRY_VALUE_KEY_NAMES(X) \
+    X(TLM_PUMP_ON,                   "pump") \
+    X(TLM_BACKOFF,                   "pump/backoff") \
+    X(TLM_PUMP_OK,                   "pump/ok") \
+    X(TLM_PUMP_NOT_OK_COUNT,         "pump/pump_not_ok_count") \
+    X(TLM_WATER_REQUEST_1,           "water_request/1") \
+    X(TLM_WATER_REQUEST_2,           "water_request/2") \
+    X(TLM_MAINS_VOLTS,               "pump/mains_volts") \
+    X(TLM_CURRENT_AMPS,              "pump/current_amps") \
+    X(TLM_POWER_WATTS,               "pump/power_watts") \
+    X(TLM_BACKOFF_TIMEOUT_S,         "pump/backoff_timeout_minutes") \
+    X(TLM_PUMP_STATE,                "pump/control_state") \
+    X(TLM_CHECK_REQUEST_MS,          "metrics/checkRequestForWater_time_ms") \
+    X(TLM_READ_CT_MS,                "metrics/readCTApparentPower_time_ms") \
+    X(TLM_HISTORY_BYTES_SAMPLE,      "metrics/history_bytes_per_sample") \
+    X(TLM_DC_OFFSET_MV,              "pump/dc_offset_mV") \
+    X(TLM_ADC_MV,                    "pump/raw/adc_mV") \
+    X(TLM_ADC_ADJUSTED_MV,           "pump/raw/adc_adjusted_mV") \
+    X(TLM_ADC_VALUE,                 "pump/raw/adc_Value") \
+    X(TLM_POWER_ACTIVE_PCT,          "power/active_pct") \
+    X(TLM_POWER_EST_MA,              "power/est_current_mA") \
+    X(TLM_POWER_EST_SAVING_PCT,      "power/est_saving_pct") \
+    X(TLM_STACK_FREE_POLL,           "metrics/ram/stack_free_poll_sensors") \
+    X(TLM_STACK_FREE_WIFI,           "metrics/ram/stack_free_wifi") \
+    X(TLM_STACK_FREE_BLINKER,        "metrics/ram/stack_free_blinker") \
+    X(TLM_STACK_FREE_LOOP,           "metrics/ram/stack_free_loop") \
+    X(TLM_RAM_STATIC_BYTES,          "metrics/ram/static_bytes") \
+    X(TLM_HEAP_FREE,                 "metrics/ram/heap_free") \
+    X(TLM_HEAP_MIN_FREE,             "metrics/ram/heap_min_free") \
+    X(TLM_HEAP_LARGEST_BLOCK,        "metrics/ram/heap_largest_block") \
+    X(TLM_INRUSH_PEAK_A,             "pump/inrush/peak_amps") \
+    X(TLM_INRUSH_PEAK_RATIO,         "pump/inrush/peak_ratio") \
+    X(TLM_INRUSH_SETTLE_MS,          "pump/inrush/settle_ms") \
+    X(TLM_INRUSH_STEADY_A,           "pump/inrush/steady_amps") \
+    X(TLM_INRUSH_BASELINE_RATIO,     "pump/inrush/baseline_peak_ratio") \
+    X(TLM_INRUSH_BASELINE_SETTLE_MS, "pump/inrush/baseline_settle_ms") \
+    X(TLM_INRUSH_DRIFT,              "pump/inrush/drift") \
+    X(TLM_INRUSH_SAMPLE_US,          "metrics/inrush_sample_us") \
+    X(TLM_LOOP_LATENESS_US,          "metrics/loop/lateness_us") \
+    X(TLM_LOOP_JITTER_US,            "metrics/loop/jitter_us") \
+    X(TLM_LOOP_EXEC_MS,              "metrics/loop/exec_ms") \
+    X(TLM_LOOP_DEADLINE_MISSES,      "metrics/loop/deadline_misses") \
+    X(TLM_LOOP_LATENESS_MAX_US,      "metrics/loop/lateness_max_us") \
+    X(TLM_LOOP_JITTER_MAX_US,        "metrics/loop/jitter_max_us") \
+    X(TLM_LOOP_LATENESS_HIST_100US,  "metrics/loop/lateness_hist/100us") \
+    X(TLM_LOOP_LATENESS_HIST_1MS,    "metrics/loop/lateness_hist/1ms") \
+    X(TLM_LOOP_LATENESS_HIST_10MS,   "metrics/loop/lateness_hist/10ms") \
+    X(TLM_LOOP_LATENESS_HIST_100MS,  "metrics/loop/lateness_hist/100ms") \
+    X(TLM_LOOP_LATENESS_HIST_1S,     "metrics/loop/lateness_hist/1s") \
+    X(TLM_LOOP_LATENESS_HIST_OVER,   "metrics/loop/lateness_hist/over") \
+    X(TLM_LOOP_JITTER_HIST_100US,    "metrics/loop/jitter_hist/100us") \
+    X(TLM_LOOP_JITTER_HIST_1MS,      "metrics/loop/jitter_hist/1ms") \
+    X(TLM_LOOP_JITTER_HIST_10MS,     "metrics/loop/jitter_hist/10ms") \
+    X(TLM_LOOP_JITTER_HIST_100MS,    "metrics/loop/jitter_hist/100ms") \
+    X(TLM_LOOP_JITTER_HIST_1S,       "metrics/loop/jitter_hist/1s") \
+    X(TLM_LOOP_JITTER_HIST_OVER,     "metrics/loop/jitter_hist/over")
+
+// Name of a key for decoders and logs, NULL if unknown
+const char *telemetryKeyName(uint32_t key);
+
+// Encode state as a TLM_FRAME_STATE frame, returns bytes written or 0 if it didn't fit
+size_t telemetryEncodeState(const State *state, uint32_t timeMs, uint8_t *out, size_t cap);
+
+// Metrics collected over one poll, written out as a single frame
+struct MetricsFrame {
+    uint8_t keys[TELEMETRY_MAX_METRICS];
+    float values[TELEMETRY_MAX_METRICS];
+    unsigned int count;
+};
+
+void metricsFrameInit(MetricsFrame *m);
+
+// Add or replace a metric, returns false when the frame is full
+bool metricsFrameAdd(MetricsFrame *m, TelemetryKey key, float value);
+
+size_t telemetryEncodeMetrics(const MetricsFrame *m, uint32_t timeMs, uint8_t *out, size_t cap);
+
+#endif /* !TELEMETRY_H */
@@ -0,0 +1,97 @@
+#include "trace.h"
+#include "history.h"
+
+static void putU16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void putU32(uint8_t *p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static uint16_t getU16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t getU32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+size_t traceRecordMaxBytes(size_t n) {
+    // A 16 bit delta zig-zags into at most 17 bits, 3 varint bytes
+    return TRACE_HEADER_BYTES + 2 + (n > 0 ? (n - 1) * 3 : 0);
+}
+
+size_t traceEncode(const TraceRecord *rec, const uint16_t *samplesMv, uint8_t *out, size_t cap) {
+    if(cap < TRACE_HEADER_BYTES + 2) {
+        return 0;
+    }
+
+    putU32(out, TRACE_MAGIC);
+    putU32(out + 4, rec->timeMs);
+    putU32(out + 8, rec->captureUs);
+    putU16(out + 12, rec->numSamples);
+    out[14] = rec->flags;
+    out[15] = 0;
+    putU16(out + 16, rec->numSamples > 0 ? samplesMv[0] : 0);
+
+    size_t pos = TRACE_HEADER_BYTES;
+    for(size_t i = 1; i < rec->numSamples; i++) {
+        uint32_t z = zigzagEncode((int32_t)samplesMv[i] - (int32_t)samplesMv[i - 1]);
+        do {
+            if(pos >= cap) {
+                return 0;
+            }
+            out[pos] = z & 0x7F;
+            z >>= 7;
+            if(z) {
+                out[pos] |= 0x80;
+            }
+            pos++;
+        } while(z);
+    }
+    return pos;
+}
+
+size_t traceDecode(const uint8_t *in, size_t len, TraceRecord *rec, uint16_t *samplesMv, size_t maxSamples) {
+    if(len < TRACE_HEADER_BYTES || getU32(in) != TRACE_MAGIC) {
+        return 0;
+    }
+
+    rec->timeMs = getU32(in + 4);
+    rec->captureUs = getU32(in + 8);
+    rec->numSamples = getU16(in + 12);
+    rec->flags = in[14];
+
+    int32_t prev = getU16(in + 16);
+    if(rec->numSamples > 0 && maxSamples > 0) {
+        samplesMv[0] = prev;
+    }
+
+    size_t pos = TRACE_HEADER_BYTES;
+    for(size_t i = 1; i < rec->numSamples; i++) {
+        uint32_t z = 0;
+        uint8_t shift = 0;
+        while(true) {
+            if(pos >= len || shift > 14) {
+                return 0;
+            }
+            uint8_t byte = in[pos++];
+            z |= (uint32_t)(byte & 0x7F) << shift;
+            shift += 7;
+            if(!(byte & 0x80)) {
+                break;
+            }
+        }
+
+        prev += zigzagDecode(z);
+        if(i < maxSamples) {
+            samplesMv[i] = prev;
+        }
+    }
+    return pos;
+}
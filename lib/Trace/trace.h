@@ -0,0 +1,47 @@
+/* trace.h */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary trace of raw ADC capture blocks.
+//
+// A trace is a plain concatenation of records so MQTT payloads can be
+// appended to a file as they arrive. All fields are little endian.
+//
+//   u32  magic        TRACE_MAGIC
+//   u32  timeMs       millis() at the start of the capture
+//   u32  captureUs    duration of the capture
+//   u16  numSamples
+//   u8   flags        TRACE_FLAG_*
+//   u8   reserved
+//   u16  firstMv      first sample in mV
+//   ...  samples      zig-zag varint deltas of the remaining samples
+
+#define TRACE_MAGIC 0x31525457  // "WTR1"
+#define TRACE_HEADER_BYTES 18
+
+#define TRACE_FLAG_REQ_1   0x01  // Raw level of PIN_IN_REQ_1 (LOW == water requested)
+#define TRACE_FLAG_REQ_2   0x02  // Raw level of PIN_IN_REQ_2
+#define TRACE_FLAG_RELAY   0x04  // Pump relay closed during the capture
+#define TRACE_FLAG_BACKOFF 0x08  // Backoff active during the capture
+
+struct TraceRecord {
+    uint32_t timeMs;
+    uint32_t captureUs;
+    uint16_t numSamples;
+    uint8_t flags;
+};
+
+// Worst case encoded size of a record with n samples
+size_t traceRecordMaxBytes(size_t n);
+
+// Encode a record and its samples, returns bytes written or 0 if out is too small
+size_t traceEncode(const TraceRecord *rec, const uint16_t *samplesMv, uint8_t *out, size_t cap);
+
+// Decode one record from in, returns bytes consumed or 0 on a short or corrupt
+// record. Samples beyond maxSamples are decoded but dropped.
+size_t traceDecode(const uint8_t *in, size_t len, TraceRecord *rec, uint16_t *samplesMv, size_t maxSamples);
+
+#endif /* !TRACE_H */
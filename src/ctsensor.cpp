@@ -1,165 +1,221 @@
 #include <math.h>
 #include <Arduino.h>
+#include <Preferences.h>
 
 #include "ctsensor.h"
+#include "config.h"
 #include "mqtt.h"
 #include "state.h"
 #include "pins.h"
+#include "power.h"
+#include "trace.h"
+#include "inrush.h"
+#include "textwriter.h"
+#include "topics.h"
 
 SemaphoreHandle_t xSemaphoreADC;
-TimerHandle_t backoffTimerHandle = NULL;
-
-unsigned int const ONE_HOUR_PERIOD_MS  = 3.6e+6;
-unsigned int const TWO_HOUR_PERIOD_MS  = (2 * ONE_HOUR_PERIOD_MS);
-unsigned int const ONE_MIN_MS          = 60000;
-unsigned int const BACKOFF_TIMER_MS    = TWO_HOUR_PERIOD_MS;
-unsigned int const PUMP_NOT_OK_LIMIT   = 3;
-
-// Parameters for measuring RMS current
-const double vRMS       = 120.0;   // Assumed or measured
-const double offset     = 1.644;   // Half the ADC max voltage in Volts (measured voltage across R2 of voltage divider)
-const double numTurns   = 2000.0;  // 1:2000 transformer turns
-const double rBurden    = 200.0;   // Burden resistor value in Ohms
-const double numSamples = 1000.0;  // Number of samples before calculating RMS
-
-const float badLoadWattsLow  = 1000.0;
-const float badLoadWattsHigh = 1500.0;
-
-void backoffTimerCallback(TimerHandle_t xTimer){
-    digitalWrite(PIN_OUT_LED_BACKOFF, LOW);
-}
 
-bool isPumpOk(State *state){
-    const float p = state->power;
+// Parameters for measuring RMS current and detecting a dry run, see pumplogic.cpp
+const PumpConfig pumpConfig = pumpConfigDefault;
 
-    // Update state.backoff == PIN_OUT_LED_BACKOFF since timer callback doesn't have access to state struct
-    state->backoff = digitalRead(PIN_OUT_LED_BACKOFF);
+// Raw readings of the last capture in mV
+uint16_t ctSamples[CT_NUM_SAMPLES];
 
-    // Update backoff timer timeout seconds if a timer exists and is active
-    if(backoffTimerHandle != NULL) { 
-        if (xTimerIsTimerActive(backoffTimerHandle)) {
-            state->backoffTimeoutSeconds = (((xTimerGetExpiryTime(backoffTimerHandle) - xTaskGetTickCount()) / portTICK_PERIOD_MS) / 1000);
-        }
+// DC offset estimate, persisted so a warm boot starts from the last value
+DcTracker dcTracker;
+Preferences ctPrefs;
+int32_t dcSavedQ16;
+unsigned long dcSavedMs = 0;
+
+unsigned int const DC_SAVE_MIN_MS = 600000;  // Limit flash writes to one per 10 minutes
+int32_t const DC_SAVE_DELTA_Q16  = 65536;    // Only save once the estimate moved by 1mV
+
+// Start-up burst and its trend. The trend averages 64 starts so losing the
+// last few to a reboot is harmless, short cycling mustn't wear the flash.
+uint16_t inrushSamples[INRUSH_NUM_SAMPLES];
+InrushTrend inrushTrend;
+unsigned long inrushSavedMs = 0;
+
+unsigned int const INRUSH_SAVE_MIN_MS = 600000;  // Same limit as the DC offset
+
+void setupCTSensor() {
+    dcTrackerInit(&dcTracker, &pumpConfig);
+
+    ctPrefs.begin("ctsensor", false);
+    dcSavedQ16 = ctPrefs.getInt("dc_bias_q16", INT32_MIN);
+    if(dcSavedQ16 != INT32_MIN) {
+        dcTrackerRestore(&dcTracker, dcSavedQ16);
     }
 
-    // If pump power consumption is in the band where we know it's sucking air then:
-    //  Count occurrences and trigger remidiation after PUMP_NOT_OK_LIMIT occurrences:
-    //      Turn off the pump
-    //      Set backoff state to true
-    //      Start the backoff timer
-    //
-    if(p >= badLoadWattsLow && p <= badLoadWattsHigh) {
-        state->pumpNotOkCount++;
-        state->pumpOk = false;
-
-        if(state->pumpNotOkCount >= PUMP_NOT_OK_LIMIT) {
-            digitalWrite(PIN_OUT_LED_BACKOFF, HIGH);  // Turn on backoff LED indicator
-            digitalWrite(PIN_OUT_PUMP_RELAY, LOW);    // Turn off pump
-            state->backoff = true;
-            state->pumpOn  = false;
-
-            // Create a backoff timer if it doesn't already exist
-            // Start backoff timer if not already active
-            if(backoffTimerHandle != NULL) {
-                if(!xTimerIsTimerActive(backoffTimerHandle)) {
-                    xTimerStart(backoffTimerHandle, 100);
-                    mqttLog("starting backoff timer");
-                } else {
-                    mqttLog("backoff timer already active");
-                    TickType_t xRemainingTime = (xTimerGetExpiryTime(backoffTimerHandle) - xTaskGetTickCount()) / portTICK_PERIOD_MS;
-                    
-                    char l[100];
-                    sprintf(l, "backoff timer will expire in %d seconds", (xRemainingTime / 1000) );
-                    mqttLog(l);
-                }
-            } else {
-                mqttLog("creating backoff timer");
-
-                backoffTimerHandle = xTimerCreate(
-                    "Backoff",
-                    BACKOFF_TIMER_MS / portTICK_PERIOD_MS,
-                    pdFALSE,
-                    NULL,
-                    backoffTimerCallback
-                );
-                
-                if(backoffTimerHandle != NULL) {
-                    xTimerStart(backoffTimerHandle, 100);
-                } else {
-                    mqttLog("ERROR: unable to create backoff timer");
-                }
-            }
-        }
+    if(ctPrefs.getBytesLength("inrush_trend") == sizeof(inrushTrend)) {
+        ctPrefs.getBytes("inrush_trend", &inrushTrend, sizeof(inrushTrend));
+    } else {
+        inrushTrendInit(&inrushTrend);
+    }
 
-        return false;
+    char l[100];
+    sprintf(l, "DC offset %s at %.4fV", dcTracker.seeded ? "restored" : "defaulted", dcTrackerVolts(&dcTracker));
+    mqttLog(l);
+}
+
+void saveDcOffset() {
+    int32_t delta = dcTracker.biasQ16 - dcSavedQ16;
+    if(dcSavedQ16 != INT32_MIN && abs(delta) < DC_SAVE_DELTA_Q16) {
+        return;
+    }
+    if(dcSavedMs != 0 && millis() - dcSavedMs < DC_SAVE_MIN_MS) {
+        return;
     }
 
-    state->pumpOk = true;
-    state->pumpNotOkCount = 0;
-    return true;
+    ctPrefs.putInt("dc_bias_q16", dcTracker.biasQ16);
+    dcSavedQ16 = dcTracker.biasQ16;
+    dcSavedMs = millis();
+}
+
+void saveInrushTrend() {
+    if(inrushSavedMs != 0 && millis() - inrushSavedMs < INRUSH_SAVE_MIN_MS) {
+        return;
+    }
+
+    ctPrefs.putBytes("inrush_trend", &inrushTrend, sizeof(inrushTrend));
+    inrushSavedMs = millis();
+}
+
+double ctOffsetVolts() {
+    return dcTrackerVolts(&dcTracker);
 }
 
+#if TRACE_RECORDING
+uint8_t traceBuf[TRACE_BUF_BYTES];
+
+void publishTrace(const State *state, uint32_t timeMs, uint32_t captureUs) {
+    TraceRecord rec;
+    rec.timeMs = timeMs;
+    rec.captureUs = captureUs;
+    rec.numSamples = CT_NUM_SAMPLES;
+    rec.flags = (state->req1 ? TRACE_FLAG_REQ_1 : 0)
+              | (state->req2 ? TRACE_FLAG_REQ_2 : 0)
+              | (state->pumpOn ? TRACE_FLAG_RELAY : 0)
+              | (state->backoff ? TRACE_FLAG_BACKOFF : 0);
+
+    size_t len = traceEncode(&rec, ctSamples, traceBuf, sizeof(traceBuf));
+    if(len > 0) {
+        mqttPublishBinary(Topics::TRACE.s, 0, false, traceBuf, len);
+    } else {
+        mqttLog("ERROR: unable to encode trace record");
+    }
+}
+#endif
+
 extern double readCTApparentPower(int pin, State *state) {
     int startTime = millis();
+    size_t n = 0;
 
-    double voltage;
-    double adjVoltage;
-    double iPrimary;
-    double iSecondary;
-    double acc = 0.0;
-    double iRMS;
-    double apparentPower;
-    
     // Take a number of samples and calculate RMS current
     if(xSemaphoreADC != NULL) {
         if(xSemaphoreTake(xSemaphoreADC, ( TickType_t ) 100) == pdTRUE) {
-            for ( int i = 0; i < numSamples; i++ ) {
-                
-                // Read ADC, convert to voltage, remove offset
-                // (offset is applied by a voltage divider in the circuit between shield and ground)
-
-                voltage = analogReadMilliVolts(pin) / 1000.0; // divide by 1000 to convert mV to V
-                adjVoltage = voltage - offset;
-                
-                iSecondary = adjVoltage / rBurden;
-                iPrimary = iSecondary * numTurns;
-
-                // Square current and add to accumulator
-                acc += pow(iPrimary, 2);
+            powerLockADC();
+            unsigned long captureStart = micros();
+            for ( ; n < CT_NUM_SAMPLES; n++ ) {
+                ctSamples[n] = analogReadMilliVolts(pin);
             }
+            unsigned long captureUs = micros() - captureStart;
+            powerUnlockADC();
             xSemaphoreGive(xSemaphoreADC);
+
+#if TRACE_RECORDING
+            publishTrace(state, startTime, captureUs);
+#else
+            (void)captureUs;
+#endif
         } else {
             mqttLog("Unable to get semaphore to read from ADC during readCTApparentPower()");
         }
     } else {
         mqttLog("xSemaphoreADC is NULL");
     }
-    
-    // Calculate RMS current from accumulated values
-    iRMS = sqrt(acc / numSamples);
 
-    // Ignore noise below 500mA
-    if(iRMS < 0.5 ) {
-        iRMS = 0.0;
+    double apparentPower = ctApparentPower(&pumpConfig, &dcTracker, ctSamples, n, state);
+    if(n > 0) {
+        saveDcOffset();
     }
-    
-    // Calculate apparent power
-    apparentPower = vRMS * iRMS;
 
+    // Every poll, so no printf
     char l[100];
-    sprintf(l, "%3.2fV * %2.1fA = %4.1fW", vRMS, iRMS, apparentPower);
+    TextWriter w;
+    textWriterInit(&w, l, sizeof(l));
+    textWriteFixed(&w, state->voltage, 2);
+    textWriteStr(&w, "V * ");
+    textWriteFixed(&w, state->current, 1);
+    textWriteStr(&w, "A = ");
+    textWriteFixed(&w, apparentPower, 1);
+    textWriteStr(&w, "W");
     mqttLog(l);
 
-    state->voltage = vRMS;
-    state->current = iRMS;
-    state->power = apparentPower;
-    
-    // realPowerWatts = apparentPowerVoltAmps * powerFactor
-    // (probably a wash in regards to the power factor of the well pump)
-
-    isPumpOk(state);
-
-    mqttPublish("well/monitor/metrics/readCTApparentPower_time_ms", 0, false, String(millis() - startTime).c_str());
+    mqttPublishMetric(TLM_DC_OFFSET_MV, ctOffsetVolts() * 1000.0, 2);
+    mqttPublishMetric(TLM_READ_CT_MS, millis() - startTime, 0);
     return apparentPower; 
 }
 
+void captureInrush(int pin) {
+    if(xSemaphoreADC == NULL) {
+        mqttLog("xSemaphoreADC is NULL");
+        return;
+    }
+    if(xSemaphoreTake(xSemaphoreADC, ( TickType_t ) 100) != pdTRUE) {
+        mqttLog("Unable to get semaphore to read from ADC during captureInrush()");
+        return;
+    }
+
+    // Paced so the samples are evenly spaced, the whole burst is taken before
+    // anything else gets the ADC. 100us is well below a tick so this spins
+    // for the full INRUSH_NUM_SAMPLES * INRUSH_SAMPLE_US (400ms) holding the
+    // ADC and the poll task, that cycle's lateness shows in looptiming.h.
+    powerLockADC();
+    unsigned long captureStart = micros();
+    unsigned long next = captureStart;
+    for(size_t n = 0; n < INRUSH_NUM_SAMPLES; n++) {
+        while((long)(micros() - next) < 0) {
+        }
+        inrushSamples[n] = analogReadMilliVolts(pin);
+        next += INRUSH_SAMPLE_US;
+    }
+    unsigned long captureUs = micros() - captureStart;
+    powerUnlockADC();
+    xSemaphoreGive(xSemaphoreADC);
+
+    // The relay was open until now so the tracker holds a clean DC offset
+    float sampleUs = (float)captureUs / INRUSH_NUM_SAMPLES;
+    InrushFeatures f;
+    bool ok = inrushAnalyse(&pumpConfig, ctOffsetVolts() * 1000.0, inrushSamples, INRUSH_NUM_SAMPLES, sampleUs, &f);
+
+    char l[120];
+    if(!ok) {
+        sprintf(l, "inrush: no start seen in %lu us (%s)", captureUs, f.started ? "too late" : "no current");
+        mqttLog(l);
+        return;
+    }
+
+    uint8_t drift = inrushTrendUpdate(&inrushTrend, &f);
+    saveInrushTrend();
+
+    sprintf(l, "inrush: peak %.1fA, %.2fx running %.2fA, settled in %.0fms%s",
+            f.peakAmps, f.peakRatio, f.steadyAmps, f.settleMs, f.settled ? "" : " (not settled)");
+    mqttLog(l);
+    for(uint8_t v = 0; v < INRUSH_TREND_COUNT; v++) {
+        if(drift & (1 << v)) {
+            sprintf(l, "WARNING: inrush %s drifted to %.2f from a baseline of %.2f over %lu starts",
+                    inrushTrendName(v), inrushTrend.recent[v], inrushTrend.baseline[v], (unsigned long)inrushTrend.starts);
+            mqttLog(l);
+        }
+    }
+
+    mqttPublishMetric(TLM_INRUSH_PEAK_A, f.peakAmps, 2);
+    mqttPublishMetric(TLM_INRUSH_PEAK_RATIO, f.peakRatio, 2);
+    mqttPublishMetric(TLM_INRUSH_SETTLE_MS, f.settleMs, 0);
+    mqttPublishMetric(TLM_INRUSH_STEADY_A, f.steadyAmps, 2);
+    mqttPublishMetric(TLM_INRUSH_BASELINE_RATIO, inrushTrend.baseline[INRUSH_TREND_PEAK_RATIO], 2);
+    mqttPublishMetric(TLM_INRUSH_BASELINE_SETTLE_MS, inrushTrend.baseline[INRUSH_TREND_SETTLE_MS], 0);
+    mqttPublishMetric(TLM_INRUSH_DRIFT, drift, 0);
+    mqttPublishMetric(TLM_INRUSH_SAMPLE_US, sampleUs, 1);
+}
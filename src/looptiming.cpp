@@ -0,0 +1,155 @@
+/* looptiming.cpp */
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#include "looptiming.h"
+#include "mqtt.h"
+#include "tasks.h"
+
+const int64_t histBoundsUs[LOOP_HIST_BUCKETS - 1] = { 100, 1000, 10000, 100000, 1000000 };
+
+int64_t loopPeriodUs = 0;
+int64_t loopDeadlineUs = 0;
+
+int64_t loopReleaseUs = 0;      // When the current cycle was due to start
+int64_t loopStartUs = 0;
+int64_t loopLastStartUs = 0;
+int64_t latenessUs = 0;
+int64_t jitterUs = 0;
+int64_t loopExecUs = 0;         // Run time of the last finished cycle
+int64_t maxLatenessUs = 0;
+int64_t maxJitterUs = 0;
+uint32_t loopCycles = 0;
+uint32_t deadlineMisses = 0;
+
+uint32_t latenessHist[LOOP_HIST_BUCKETS];
+uint32_t jitterHist[LOOP_HIST_BUCKETS];
+
+// Filled in by the deadline timer, read back by the poll task once the cycle ends
+struct DeadlineSnapshot {
+    char running[portNUM_PROCESSORS][configMAX_TASK_NAME_LEN];
+    eTaskState pollState;
+    volatile bool taken;
+};
+
+DeadlineSnapshot deadlineSnapshot;
+esp_timer_handle_t deadlineTimer = NULL;
+
+// Runs in the esp_timer task, so on its own core that is what's running and
+// only the other core shows the task that held the CPU
+void onDeadline(void *arg) {
+    for(int core = 0; core < portNUM_PROCESSORS; core++) {
+        TaskHandle_t t = xTaskGetCurrentTaskHandleForCPU(core);
+        strncpy(deadlineSnapshot.running[core], t != NULL ? pcTaskGetName(t) : "-", configMAX_TASK_NAME_LEN - 1);
+        deadlineSnapshot.running[core][configMAX_TASK_NAME_LEN - 1] = '\0';
+    }
+    deadlineSnapshot.pollState = hPollSensors != NULL ? eTaskGetState(hPollSensors) : eInvalid;
+    deadlineSnapshot.taken = true;
+}
+
+const char *taskStateName(eTaskState s) {
+    switch(s) {
+    case eRunning:   return "running";
+    case eReady:     return "ready";
+    case eBlocked:   return "blocked";
+    case eSuspended: return "suspended";
+    default:         return "?";
+    }
+}
+
+void histAdd(uint32_t *hist, int64_t us) {
+    int b = 0;
+    while(b < LOOP_HIST_BUCKETS - 1 && us >= histBoundsUs[b]) {
+        b++;
+    }
+    hist[b]++;
+}
+
+void loopTimingInit(uint32_t periodMs, uint32_t deadlineMs) {
+    loopPeriodUs = (int64_t)periodMs * 1000;
+    loopDeadlineUs = (int64_t)deadlineMs * 1000;
+
+    esp_timer_create_args_t args = {};
+    args.callback = onDeadline;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "loop_deadline";
+    if(esp_timer_create(&args, &deadlineTimer) != ESP_OK) {
+        mqttLog("ERROR: unable to create the loop deadline timer");
+        deadlineTimer = NULL;
+    }
+}
+
+void loopTimingStart() {
+    loopStartUs = esp_timer_get_time();
+
+    if(loopCycles == 0) {
+        loopReleaseUs = loopStartUs;
+    } else {
+        // vTaskDelayUntil() never skips a period, after a stall it runs the missed
+        // cycles back to back until it has caught up, so neither does the schedule
+        loopReleaseUs += loopPeriodUs;
+
+        latenessUs = loopStartUs - loopReleaseUs;
+        jitterUs = (loopStartUs - loopLastStartUs) - loopPeriodUs;
+        int64_t absJitterUs = jitterUs < 0 ? -jitterUs : jitterUs;
+
+        // Tick rounding can wake a cycle slightly before its release, count that as on time
+        histAdd(latenessHist, latenessUs > 0 ? latenessUs : 0);
+        histAdd(jitterHist, absJitterUs);
+        if(latenessUs > maxLatenessUs) {
+            maxLatenessUs = latenessUs;
+        }
+        if(absJitterUs > maxJitterUs) {
+            maxJitterUs = absJitterUs;
+        }
+    }
+    loopLastStartUs = loopStartUs;
+    loopCycles++;
+
+    if(deadlineTimer != NULL) {
+        deadlineSnapshot.taken = false;
+        int64_t left = loopReleaseUs + loopDeadlineUs - loopStartUs;
+        esp_timer_start_once(deadlineTimer, left > 0 ? left : 1);
+    }
+}
+
+void loopTimingEnd() {
+    int64_t endUs = esp_timer_get_time();
+    loopExecUs = endUs - loopStartUs;
+
+    if(deadlineTimer != NULL) {
+        esp_timer_stop(deadlineTimer);
+    }
+
+    if(endUs - loopReleaseUs <= loopDeadlineUs) {
+        return;
+    }
+    deadlineMisses++;
+
+    char l[120];
+    if(deadlineSnapshot.taken) {
+        sprintf(l, "loop deadline missed by %lld ms, poll task %s, core 0 ran %s, core 1 ran %s",
+                (long long)((endUs - loopReleaseUs - loopDeadlineUs) / 1000), taskStateName(deadlineSnapshot.pollState),
+                deadlineSnapshot.running[0], deadlineSnapshot.running[portNUM_PROCESSORS - 1]);
+    } else {
+        sprintf(l, "loop deadline missed by %lld ms", (long long)((endUs - loopReleaseUs - loopDeadlineUs) / 1000));
+    }
+    mqttLog(l);
+}
+
+void loopTimingPublish(bool histograms) {
+    mqttPublishMetric(TLM_LOOP_LATENESS_US, latenessUs, 0);
+    mqttPublishMetric(TLM_LOOP_JITTER_US, jitterUs, 0);
+    mqttPublishMetric(TLM_LOOP_EXEC_MS, loopExecUs / 1000.0, 1);
+    mqttPublishMetric(TLM_LOOP_DEADLINE_MISSES, deadlineMisses, 0);
+
+    if(!histograms) {
+        return;
+    }
+    mqttPublishMetric(TLM_LOOP_LATENESS_MAX_US, maxLatenessUs, 0);
+    mqttPublishMetric(TLM_LOOP_JITTER_MAX_US, maxJitterUs, 0);
+    for(int b = 0; b < LOOP_HIST_BUCKETS; b++) {
+        mqttPublishMetric((TelemetryKey)(TLM_LOOP_LATENESS_HIST + b), latenessHist[b], 0);
+        mqttPublishMetric((TelemetryKey)(TLM_LOOP_JITTER_HIST + b), jitterHist[b], 0);
+    }
+}
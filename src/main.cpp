@@ -11,6 +11,9 @@
 #include "ota.h"
 #include "mqtt.h"
 #include "homeassistant.hpp"
+#include "power.h"
+#include "rambudget.h"
+#include "config.h"
 
 #define true 1
 #define false 0
@@ -18,6 +21,25 @@
 /* struct to hold the state variables for the pump monitor */
 struct State state;
 
+// HomeAssistant discovery configs, re-sent less often when saving power
+#if POWER_MANAGEMENT
+const unsigned long HA_DISCOVERY_MS = 60000;
+#else
+const unsigned long HA_DISCOVERY_MS = 5000;
+#endif
+unsigned long lastDiscoveryMs = 0;
+
+#if STATIC_ALLOCATION
+// Task stacks and control blocks, StackType_t is a byte on the ESP32
+StackType_t stackBlinker[STACK_BLINKER];
+StackType_t stackWifi[STACK_WIFI];
+StackType_t stackPollSensors[STACK_POLL_SENSORS];
+StaticTask_t tcbBlinker;
+StaticTask_t tcbWifi;
+StaticTask_t tcbPollSensors;
+StaticSemaphore_t semaphoreADCBuffer;
+#endif
+
 // NTP Time
 const char *ntpServer         = "north-america.pool.ntp.org";
 const long gmtOffset_sec      = -28800; // GMT -8:00 (Pacific)
@@ -50,6 +72,7 @@ void setDefaultState() {
     state.pumpOk = true;
     state.pumpNotOkCount = 0;
     state.backoffTimeoutSeconds = 0;
+    state.pumpState = 0;
     state.req1 = false;
     state.req2 = false;
     state.voltage = 0;
@@ -67,35 +90,70 @@ void setup() {
     /* Set default state */
     setDefaultState();
 
+    /* Enable power management when configured */
+    setupPower();
+
     /* Create semaphore to guard reads of ADC */
+#if STATIC_ALLOCATION
+    xSemaphoreADC = xSemaphoreCreateMutexStatic(&semaphoreADCBuffer);
+#else
     xSemaphoreADC = xSemaphoreCreateMutex();
+#endif
 
     if(xSemaphoreADC == NULL) {
         mqttLog("ERROR creating xSemaphoreADC to guard ADC reads");
     }
 
+    /* Restore the CT sensor DC offset estimate */
+    setupCTSensor();
+
     /* Task - blink onboard LED */
-    unsigned int blinkPeriod = 700;
+    static unsigned int blinkPeriod = 700; // Outlives setup(), the task keeps a pointer to it
+#if STATIC_ALLOCATION
+    hBlinker = xTaskCreateStatic(
+        taskBlinkLED,
+        "task Blink LED",
+        STACK_BLINKER,
+        &blinkPeriod,
+        1,
+        stackBlinker,
+        &tcbBlinker
+    );
+#else
     xTaskCreate(
         taskBlinkLED,
         "task Blink LED",
-        900,
+        STACK_BLINKER,
         &blinkPeriod,
         1,
         &hBlinker
     );
+#endif
     vTaskSuspend(hBlinker);
 
     /* Task - Establish and maintain a WiFi connection */
+#if STATIC_ALLOCATION
+    hWifi = xTaskCreateStaticPinnedToCore(
+        taskWifi,           // Function for task
+        "task Wifi",        // Task name
+        STACK_WIFI,         // Stack size (bytes)
+        NULL,               // Parameter
+        1,                  // Task priority, larger number is higher priority
+        stackWifi,          // Stack buffer
+        &tcbWifi,           // Task control block
+        0                   // Core to pin to, 0 or 1
+    );
+#else
     xTaskCreatePinnedToCore(
         taskWifi,    // Function for task
         "task Wifi", // Task name
-        5000,        // Stack size (bytes)
+        STACK_WIFI,  // Stack size (bytes)
         NULL,        // Parameter
         1,           // Task priority, larger number is higher priority
-        NULL,        // Task handle
+        &hWifi,      // Task handle
         0            // Core to pin to, 0 or 1
     );
+#endif
 
     /* Check WiFi Connection */
     Serial.println("Waiting for Wifi connection");
@@ -116,20 +174,40 @@ void setup() {
     setupMQTT();
 
     /* Task - Poll Sensors */
+#if STATIC_ALLOCATION
+    hPollSensors = xTaskCreateStatic(
+        taskPollSensors,
+        "task Poll Sensors",
+        STACK_POLL_SENSORS,
+        &state,
+        3,
+        stackPollSensors,
+        &tcbPollSensors
+    );
+#else
     xTaskCreate(
         taskPollSensors,
         "task Poll Sensors",
-        5000,
+        STACK_POLL_SENSORS,
         &state,
         3,
         &hPollSensors
     );
+#endif
 
     mqttLog("Well monitor setup complete");
+    ramBudgetLog();
 }
 
 void loop() {
     ArduinoOTA.handle();
-    HASetupSensors();
+
+    if(lastDiscoveryMs == 0 || millis() - lastDiscoveryMs >= HA_DISCOVERY_MS) {
+        powerLockNet();
+        HASetupSensors();
+        powerUnlockNet();
+        lastDiscoveryMs = millis();
+    }
+
     vTaskDelay(5000 / portTICK_PERIOD_MS);
 }
@@ -8,11 +8,23 @@
 #include "mqtt.h"
 #include "secrets.h"
 #include "config.h"
+#include "tasks.h"
+#include "textwriter.h"
+#include "topics.h"
 
 AsyncMqttClient mqttClient;
 
+#if TELEMETRY_FORMAT == TELEMETRY_CBOR
+MetricsFrame metricsFrame;
+uint8_t metricsBuf[TELEMETRY_FRAME_BYTES];
+#endif
+
 TimerHandle_t mqttReconnectTimer;
 
+#if STATIC_ALLOCATION
+StaticTimer_t mqttReconnectTimerBuffer;
+#endif
+
 void connectToMqtt() {
     if(!mqttClient.connected()) {
         Serial.println("Connecting to MQTT...");
@@ -44,6 +56,9 @@ void onMqttConnect(bool sessionPresent) {
     Serial.print("Session present: ");
     Serial.println(sessionPresent);
 
+    mqttClient.subscribe(Topics::PUMP_OVERRIDE.s, 1);
+    mqttClient.subscribe(Topics::HA_SWITCH_SET.s, 1);
+
     uint16_t packetIdSub = mqttClient.subscribe("test/lol", 2);
     Serial.print("Subscribing at QoS 2, packetId: ");
     Serial.println(packetIdSub);
@@ -98,6 +113,17 @@ void onMqttMessage(char* topic, char* payload, AsyncMqttClientMessageProperties
     Serial.print(index);
     Serial.print("  total: ");
     Serial.println(total);
+
+    if(!isOverrideTopic(topic)) {
+        return;
+    }
+
+    int event = overrideEvent(payload, len);
+    if(event >= 0) {
+        requestPumpOverride(event);
+    } else {
+        mqttLog("ERROR: unknown pump override payload");
+    }
 }
 
 void onMqttPublish(uint16_t packetId) {
@@ -111,8 +137,13 @@ void setupMQTT() {
     Serial.println("Setup MQTT");
 
     // Create a timer to connect to mqtt periodically
+#if STATIC_ALLOCATION
+    mqttReconnectTimer = xTimerCreateStatic("mqttTimer", pdMS_TO_TICKS(2000), pdFALSE, (void*)0, 
+        reinterpret_cast<TimerCallbackFunction_t>(connectToMqtt), &mqttReconnectTimerBuffer);
+#else
     mqttReconnectTimer = xTimerCreate("mqttTimer", pdMS_TO_TICKS(2000), pdFALSE, (void*)0, 
         reinterpret_cast<TimerCallbackFunction_t>(connectToMqtt));
+#endif
 
     WiFi.onEvent(WiFiEvent);
 
@@ -137,7 +168,49 @@ uint16_t mqttPublish(const char* topic, uint8_t qos, bool retain, const char* pa
     return mqttClient.publish(topic, qos, retain, payload);
 }
 
+uint16_t mqttPublishBinary(const char* topic, uint8_t qos, bool retain, const uint8_t* payload, size_t length) {
+    return mqttClient.publish(topic, qos, retain, (const char*)payload, length);
+}
+
+void mqttSinkPublish(void *ctx, const char *topic, uint8_t qos, bool retain, const uint8_t *payload, size_t len) {
+    mqttClient.publish(topic, qos, retain, (const char*)payload, len);
+}
+
+const PublishSink mqttSink = { mqttSinkPublish, NULL };
+
 uint16_t mqttLog(const char* msg) {
-    Serial.println("[Log]: " + String(msg));
-    return mqttClient.publish(MQTT_TOPIC_LOG, 0, false, msg);
+    Serial.print("[Log]: ");
+    Serial.println(msg);
+    return mqttClient.publish(Topics::LOG.s, 0, false, msg);
+}
+
+void mqttPublishMetric(TelemetryKey key, float value, unsigned char decimals) {
+#if TELEMETRY_FORMAT == TELEMETRY_CBOR
+    // A full frame goes out early rather than dropping the metric
+    if(!metricsFrameAdd(&metricsFrame, key, value)) {
+        mqttFlushMetrics();
+        metricsFrameAdd(&metricsFrame, key, value);
+    }
+#else
+    const char *topic = telemetryTopic(key);
+    char v[24];
+    TextWriter w;
+    textWriterInit(&w, v, sizeof(v));
+    textWriteFixed(&w, value, decimals);
+    if(topic != NULL && !w.overflow) {
+        mqttPublishBinary(topic, 0, false, (const uint8_t*)v, w.len);
+    }
+#endif
+}
+
+void mqttFlushMetrics() {
+#if TELEMETRY_FORMAT == TELEMETRY_CBOR
+    if(metricsFrame.count > 0) {
+        size_t len = telemetryEncodeMetrics(&metricsFrame, millis(), metricsBuf, sizeof(metricsBuf));
+        if(len > 0) {
+            mqttPublishBinary(Topics::CBOR_METRICS.s, 0, false, metricsBuf, len);
+        }
+        metricsFrameInit(&metricsFrame);
+    }
+#endif
 }
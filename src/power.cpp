@@ -0,0 +1,157 @@
+/* power.cpp */
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include "power.h"
+#include "config.h"
+#include "mqtt.h"
+
+#if POWER_MANAGEMENT
+#include <esp_pm.h>
+#include <esp_timer.h>
+
+// Rough supply current per mode in mA, ESP32 datasheet "Power Consumption by Power Modes"
+const float ACTIVE_MA         = 68.0;   // 240MHz, radio in modem sleep
+const float IDLE_MA           = 20.0;   // 80MHz with modem sleep, light sleep unavailable
+const float LIGHT_SLEEP_MA    = 0.8;
+const float WIFI_DTIM_AVG_MA  = 4.0;    // Average cost of waking for beacons with max modem sleep
+const float BASELINE_MA       = 100.0;  // 240MHz, radio listening (build without power management)
+
+esp_pm_lock_handle_t adcLock = NULL;
+esp_pm_lock_handle_t adcSleepLock = NULL;
+esp_pm_lock_handle_t netLock = NULL;
+bool pmEnabled = false;          // esp_pm_configure() succeeded, fails on cores without CONFIG_PM_ENABLE
+bool lightSleepEnabled = false;
+
+// Time during which any lock is held, the rest is assumed to be spent idle or asleep
+portMUX_TYPE powerMux = portMUX_INITIALIZER_UNLOCKED;
+unsigned int lockHolders = 0;
+int64_t lockStartUs = 0;
+int64_t lockedUs = 0;
+int64_t periodStartUs = 0;
+
+void lockAccountingEnter() {
+    portENTER_CRITICAL(&powerMux);
+    if(lockHolders++ == 0) {
+        lockStartUs = esp_timer_get_time();
+    }
+    portEXIT_CRITICAL(&powerMux);
+}
+
+void lockAccountingExit() {
+    portENTER_CRITICAL(&powerMux);
+    if(lockHolders > 0 && --lockHolders == 0) {
+        lockedUs += esp_timer_get_time() - lockStartUs;
+    }
+    portEXIT_CRITICAL(&powerMux);
+}
+
+void setupPower() {
+    esp_pm_config_esp32_t pm;
+    pm.max_freq_mhz = 240;
+    pm.min_freq_mhz = 80;
+    pm.light_sleep_enable = true;
+
+    // Light sleep needs tickless idle in the sdkconfig, fall back to DFS only
+    esp_err_t err = esp_pm_configure(&pm);
+    if(err == ESP_OK) {
+        lightSleepEnabled = true;
+    } else {
+        pm.light_sleep_enable = false;
+        err = esp_pm_configure(&pm);
+    }
+    pmEnabled = (err == ESP_OK);
+
+    char l[100];
+    sprintf(l, "power management: %s, light sleep %s", esp_err_to_name(err), lightSleepEnabled ? "on" : "off");
+    mqttLog(l);
+
+    if(pmEnabled) {
+        esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "adc", &adcLock);
+        esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "adc_sleep", &adcSleepLock);
+        esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "net", &netLock);
+    }
+
+    periodStartUs = esp_timer_get_time();
+}
+
+void powerWifiConnected() {
+    // Sleep between DTIM beacons, the broker connection stays up through
+    // keep-alives. Set once the station is up, before WiFi.mode() it is lost.
+    WiFi.setSleep(WIFI_PS_MAX_MODEM);
+}
+
+void powerLockADC() {
+    if(adcLock != NULL) {
+        esp_pm_lock_acquire(adcLock);
+        esp_pm_lock_acquire(adcSleepLock);
+        lockAccountingEnter();
+    }
+}
+
+void powerUnlockADC() {
+    if(adcLock != NULL) {
+        lockAccountingExit();
+        esp_pm_lock_release(adcSleepLock);
+        esp_pm_lock_release(adcLock);
+    }
+}
+
+void powerLockNet() {
+    if(netLock != NULL) {
+        esp_pm_lock_acquire(netLock);
+        lockAccountingEnter();
+    }
+}
+
+void powerUnlockNet() {
+    if(netLock != NULL) {
+        lockAccountingExit();
+        esp_pm_lock_release(netLock);
+    }
+}
+
+void powerPublishMetrics() {
+    portENTER_CRITICAL(&powerMux);
+    int64_t now = esp_timer_get_time();
+    int64_t locked = lockedUs;
+    if(lockHolders > 0) {
+        locked += now - lockStartUs;
+        lockStartUs = now;
+    }
+    int64_t elapsed = now - periodStartUs;
+    lockedUs = 0;
+    periodStartUs = now;
+    portEXIT_CRITICAL(&powerMux);
+
+    if(elapsed <= 0) {
+        return;
+    }
+
+    // Running at a fixed 240MHz, the locks were never created
+    if(!pmEnabled) {
+        mqttPublishMetric(TLM_POWER_EST_MA, BASELINE_MA, 1);
+        mqttPublishMetric(TLM_POWER_EST_SAVING_PCT, 0, 1);
+        return;
+    }
+
+    float active = (float)locked / elapsed;
+    float idleMa = lightSleepEnabled ? LIGHT_SLEEP_MA + WIFI_DTIM_AVG_MA : IDLE_MA;
+    float estimateMa = active * ACTIVE_MA + (1.0 - active) * idleMa;
+
+    mqttPublishMetric(TLM_POWER_ACTIVE_PCT, active * 100.0, 2);
+    mqttPublishMetric(TLM_POWER_EST_MA, estimateMa, 1);
+    mqttPublishMetric(TLM_POWER_EST_SAVING_PCT, (1.0 - estimateMa / BASELINE_MA) * 100.0, 1);
+}
+
+#else
+
+void setupPower() {}
+void powerWifiConnected() {}
+void powerLockADC() {}
+void powerUnlockADC() {}
+void powerLockNet() {}
+void powerUnlockNet() {}
+void powerPublishMetrics() {}
+
+#endif
@@ -0,0 +1,81 @@
+/* rambudget.cpp */
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+#include "rambudget.h"
+#include "config.h"
+#include "tasks.h"
+#include "ctsensor.h"
+#include "history.h"
+#include "trace.h"
+#include "mqtt.h"
+#include "homeassistant.hpp"
+
+struct RamRegion {
+    const char *name;
+    unsigned int bytes;
+};
+
+// Long lived buffers, measured from the objects themselves
+constexpr RamRegion ramStatic[] = {
+    { "ctSamples",        sizeof(ctSamples) },
+    { "historyBlocks",    sizeof(historyBlocks) },
+    { "inrushSamples",    sizeof(inrushSamples) },
+#if TRACE_RECORDING
+    { "traceBuf",         sizeof(traceBuf) },
+#endif
+#if STATIC_ALLOCATION
+    { "stack Blink LED",  sizeof(stackBlinker) + sizeof(tcbBlinker) },
+    { "stack Wifi",       sizeof(stackWifi) + sizeof(tcbWifi) },
+    { "stack Poll",       sizeof(stackPollSensors) + sizeof(tcbPollSensors) },
+    { "semaphore ADC",    sizeof(semaphoreADCBuffer) },
+    { "timer mqtt",       sizeof(mqttReconnectTimerBuffer) },
+    { "HA discovery",     sizeof(HADiscoveryBuffer) },
+#endif
+};
+
+const unsigned int RAM_STATIC_COUNT = sizeof(ramStatic) / sizeof(ramStatic[0]);
+
+constexpr unsigned int ramStaticTotal(unsigned int i = 0) {
+    return i == sizeof(ramStatic) / sizeof(ramStatic[0]) ? 0 : ramStatic[i].bytes + ramStaticTotal(i + 1);
+}
+
+static_assert(ramStaticTotal() <= STATIC_RAM_BUDGET, "static allocations exceed STATIC_RAM_BUDGET");
+
+unsigned int ramBudgetStaticBytes() {
+    return ramStaticTotal();
+}
+
+void ramBudgetLog() {
+    char l[100];
+    for(unsigned int i = 0; i < RAM_STATIC_COUNT; i++) {
+        sprintf(l, "ram static %-16s %6u bytes", ramStatic[i].name, ramStatic[i].bytes);
+        mqttLog(l);
+    }
+
+    sprintf(l, "ram static total %u of %u bytes, heap free %u, min free %u, largest block %u",
+            ramStaticTotal(), (unsigned int)STATIC_RAM_BUDGET,
+            (unsigned int)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+            (unsigned int)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+            (unsigned int)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    mqttLog(l);
+}
+
+void publishStackFree(TelemetryKey key, TaskHandle_t task) {
+    if(task != NULL) {
+        // High water mark is in bytes on the ESP32
+        mqttPublishMetric(key, uxTaskGetStackHighWaterMark(task), 0);
+    }
+}
+
+void ramBudgetReport() {
+    publishStackFree(TLM_STACK_FREE_POLL, hPollSensors);
+    publishStackFree(TLM_STACK_FREE_WIFI, hWifi);
+    publishStackFree(TLM_STACK_FREE_BLINKER, hBlinker);
+    publishStackFree(TLM_STACK_FREE_LOOP, xTaskGetHandle("loopTask"));
+
+    mqttPublishMetric(TLM_RAM_STATIC_BYTES, ramStaticTotal(), 0);
+    mqttPublishMetric(TLM_HEAP_FREE, heap_caps_get_free_size(MALLOC_CAP_8BIT), 0);
+    mqttPublishMetric(TLM_HEAP_MIN_FREE, heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT), 0);
+    mqttPublishMetric(TLM_HEAP_LARGEST_BLOCK, heap_caps_get_largest_free_block(MALLOC_CAP_8BIT), 0);
+}
@@ -5,7 +5,7 @@
 
 void setPumpRelay(short int state) {
     pinMode(PIN_OUT_PUMP_RELAY, OUTPUT);
-    digitalWrite(PIN_OUT_PUMP_RELAY, HIGH);
+    digitalWrite(PIN_OUT_PUMP_RELAY, state);
 }
 
 void setBackoff(short int state) {
@@ -9,6 +9,12 @@
 #include "ctsensor.h"
 #include "mqtt.h"
 #include "state.h"
+#include "pumpcontrol.h"
+#include "history.h"
+#include "power.h"
+#include "rambudget.h"
+#include "looptiming.h"
+#include "publish.h"
 
 // Timers
 unsigned int const WIFI_WATCHDOG_MS     = 10000; // 10 second WiFi connection watchdog timer
@@ -29,6 +35,18 @@ extern const uint8_t PIN_LED_ERROR       = LED_BUILTIN;
 // Task handles
 TaskHandle_t hPollSensors = NULL;
 TaskHandle_t hBlinker = NULL;
+TaskHandle_t hWifi = NULL;
+
+// Pump control state machine, see pumpcontrol.h
+PumpController pumpController;
+uint32_t pumpLogged = 0;
+
+// Override command from MQTT, applied by the poll task on its next cycle
+volatile int pendingOverride = -1;
+
+// Compressed power history, the active block plus the last full one
+HistoryBlock historyBlocks[HISTORY_BLOCKS];
+unsigned int historyActive = 0;
 
 // State
 // int state_req_1   = 0;
@@ -74,6 +92,7 @@ void taskWifi(void * parameter) {
 
         Serial.println("[WIFI] Connected");
         Serial.print("IP address: " + WiFi.localIP().toString() + "\n");
+        powerWifiConnected();
         vTaskSuspend(hBlinker);
         digitalWrite(LED_BUILTIN, LOW);
     }
@@ -100,68 +119,99 @@ void checkRequestForWater(State *state) {
     state->req1 = req_1_val;
     state->req2 = req_2_val;
 
-    Serial.println("Request 1: " + String(req_1_val));
-    Serial.println("Request 2: " + String(req_2_val));
+    // Every poll, so no String. Print as digits, a char would go out as a raw byte
+    Serial.print("Request 1: ");
+    Serial.println((int)req_1_val);
+    Serial.print("Request 2: ");
+    Serial.println((int)req_2_val);
 
-    mqttPublish("well/monitor/metrics/checkRequestForWater_time_ms", 0, false, String(millis() - startTime).c_str());
+    mqttPublishMetric(TLM_CHECK_REQUEST_MS, millis() - startTime, 0);
+}
+
+void requestPumpOverride(int event) {
+    pendingOverride = event;
 }
 
 void resolveState(State *state) {
-    
+    uint32_t now = millis();
+    bool wasOn = pumpController.relay;
+
+    int override = pendingOverride;
+    if(override >= 0) {
+        pendingOverride = -1;
+        pumpControlEvent(&pumpController, (PumpEvent)override, now);
+    }
+
     // LOW is a request for water
     // HIGH on both request pins should turn off pump
     // HIGH on PIN_OUT_PUMP_RELAY turns relay ON
-    if(state->req1 && state->req2) {
-        digitalWrite(PIN_OUT_PUMP_RELAY, LOW);
-        state->pumpOn = LOW;
-    } else {
-        // If backoff is true then turn off pump
-        if (state->backoff) { 
-            digitalWrite(PIN_OUT_PUMP_RELAY, LOW);
-            state->pumpOn = LOW;
-        } else {
-            digitalWrite(PIN_OUT_PUMP_RELAY, HIGH);
-            state->pumpOn = HIGH;
-         }
+    pumpControlStep(&pumpController, state, now);
+    setPumpRelay(state->pumpOn ? HIGH : LOW);
+    setBackoff(state->backoff ? HIGH : LOW);
+
+    // The first few hundred ms after closing carry the motor's start-up signature
+    if(state->pumpOn && !wasOn) {
+        captureInrush(PIN_ADC_CT_1);
+    }
+
+    // Log transitions taken since the last cycle, the ring keeps the last PUMP_LOG_SIZE
+    if(pumpController.logCount - pumpLogged > PUMP_LOG_SIZE) {
+        pumpLogged = pumpController.logCount - PUMP_LOG_SIZE;
+    }
+    for( ; pumpLogged < pumpController.logCount; pumpLogged++) {
+        const PumpTransitionRecord *r = &pumpController.log[pumpLogged % PUMP_LOG_SIZE];
+        char l[100];
+        sprintf(l, "pump %s -> %s on %s at %lu ms", pumpStateName(r->from), pumpStateName(r->to),
+                pumpEventName(r->event), (unsigned long)r->timeMs);
+        mqttLog(l);
     }
 }
 
-void mqttPublishState(State *state){
-    // Send inverse of pin read to mqtt as these are PULL DOWN pins where LOW == TRUE
-    mqttPublish("well/monitor/water_request/1", 0, false, String(!state->req1).c_str());
-    mqttPublish("well/monitor/water_request/2", 0, false, String(!state->req2).c_str());
+void recordHistory(State *state) {
+    HistoryBlock *b = &historyBlocks[historyActive];
 
-    const char *pumpState = "OFF"; 
-    if(state->pumpOn) {
-        pumpState = "ON";
-    } else {
-        pumpState = "OFF";
+    // When the active block is full keep it as the previous block and start a new one
+    if(!historyBlockAppend(b, millis(), state->power, state->current)) {
+        historyActive = (historyActive + 1) % HISTORY_BLOCKS;
+        b = &historyBlocks[historyActive];
+        historyBlockInit(b);
+        historyBlockAppend(b, millis(), state->power, state->current);
     }
-    mqttPublish("well/monitor/pump", 0, false, pumpState);
 
-    const char *backoffState = "OFF"; 
-    if(state->backoff) {
-        backoffState = "ON";
-    } else {
-        backoffState = "OFF";
+    if(b->count > 0) {
+        mqttPublishMetric(TLM_HISTORY_BYTES_SAMPLE, (float)historyBlockBytes(b) / b->count, 2);
     }
-    mqttPublish("well/monitor/pump/backoff", 0, true, backoffState);
-    mqttPublish("well/monitor/pump/pump_not_ok_count", 0, true, String(state->pumpNotOkCount).c_str());
+}
 
-    mqttPublish("well/monitor/pump/mains_volts", 0, false, String(state->voltage).c_str());
-    mqttPublish("well/monitor/pump/current_amps", 0, false, String(state->current).c_str());
-    mqttPublish("well/monitor/pump/power_watts", 0, false, String(state->power).c_str());
+#if TELEMETRY_FORMAT == TELEMETRY_CBOR
+uint8_t stateBuf[TELEMETRY_FRAME_BYTES];
+#endif
 
-    mqttPublish("well/monitor/pump/backoff_timeout_minutes", 0, false, String(state->backoffTimeoutSeconds).c_str());
+void mqttPublishState(State *state){
+#if TELEMETRY_FORMAT == TELEMETRY_CBOR
+    publishStateCbor(&mqttSink, state, millis(), stateBuf, sizeof(stateBuf));
+#else
+    publishStateText(&mqttSink, state);
+#endif
 
     // Update HomeAssistant state endpoint
-    char l[100];
-    sprintf(l, "{\"state\": \"%s\", \"current\": %2.2f, \"power\": %.0f}", pumpState, state->current, state->power );
-    mqttPublish("homeassistant/sensor/well_monitor/state", 0, true, l);
+    publishHAState(&mqttSink, state);
 }
 
 void taskPollSensors(void * state) {
+    for(unsigned int i = 0; i < HISTORY_BLOCKS; i++) {
+        historyBlockInit(&historyBlocks[i]);
+    }
+    pumpControlInit(&pumpController, &pumpConfig, millis());
+    loopTimingInit(POLL_SENSORS_MS, LOOP_DEADLINE_MS);
+    unsigned int polls = 0;
+
+    // Fixed period from one start to the next, however long a cycle takes
+    TickType_t lastWake = xTaskGetTickCount();
+
     while(1){
+        loopTimingStart();
+
         struct tm timeinfo;
         getLocalTime(&timeinfo);
         Serial.print(&timeinfo, "%x %X");
@@ -177,18 +227,33 @@ void taskPollSensors(void * state) {
         // Look at State struct and resolve desired state
         resolveState(s);
 
+        // Append power and current to the compressed history
+        recordHistory(s);
+
         // Publish state to MQTT
+        powerLockNet();
         mqttPublishState(s);
+        powerPublishMetrics();
+
+        // Stack and heap headroom and the timing histograms once a minute
+        bool minute = (polls++ % 6 == 0);
+        if(minute) {
+            ramBudgetReport();
+        }
+        loopTimingPublish(minute);
+        powerUnlockNet();
 
         if(xSemaphoreADC != NULL) {
             if(xSemaphoreTake(xSemaphoreADC, ( TickType_t ) 100) == pdTRUE) {
+                powerLockADC();
                 unsigned int adc_Value = analogRead(PIN_ADC_CT_1);
                 int adc_mV = analogReadMilliVolts(PIN_ADC_CT_1);
+                powerUnlockADC();
                 xSemaphoreGive(xSemaphoreADC);
 
-                mqttPublish("well/monitor/pump/raw/adc_mV", 0, false, String(adc_mV).c_str());
-                mqttPublish("well/monitor/pump/raw/adc_adjusted_mV", 0, false, String(adc_mV - (offset * 1000)).c_str());
-                mqttPublish("well/monitor/pump/raw/adc_Value", 0, false, String(adc_Value).c_str());
+                mqttPublishMetric(TLM_ADC_MV, adc_mV, 0);
+                mqttPublishMetric(TLM_ADC_ADJUSTED_MV, adc_mV - (ctOffsetVolts() * 1000), 2);
+                mqttPublishMetric(TLM_ADC_VALUE, adc_Value, 0);
             } else {
                 mqttLog("Unable to get semaphore to read from ADC during taskPollSensors()");
             }
@@ -196,7 +261,11 @@ void taskPollSensors(void * state) {
             mqttLog("xSemaphoreADC is NULL");
         }
 
-        vTaskDelay(POLL_SENSORS_MS / portTICK_PERIOD_MS);
+        // Everything collected this poll goes out as one frame with TELEMETRY_CBOR
+        mqttFlushMetrics();
+
+        loopTimingEnd();
+        vTaskDelayUntil(&lastWake, POLL_SENSORS_MS / portTICK_PERIOD_MS);
     }
 }
 
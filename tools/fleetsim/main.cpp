@@ -0,0 +1,586 @@
+/* fleetsim - many virtual well monitors against one MQTT broker
+ *
+ *   fleetsim [options]
+ *     --host H          broker address (127.0.0.1)
+ *     --port P          broker port (1883)
+ *     --devices N       virtual devices, one connection each (100)
+ *     --seconds S       how long to run (60)
+ *     --speed X         run the 10 s poll and 5 s discovery X times faster (1)
+ *     --cbor            TELEMETRY_CBOR payloads instead of text topics
+ *     --qos Q           publish everything at QoS Q instead of what the firmware uses
+ *     --sync            every device polls at the same moment instead of spread out
+ *     --no-observer     don't subscribe to the fleet's traffic, no latency figures
+ *     --report S        seconds between progress lines (10)
+ *     -v                a line per device at the end
+ *
+ * Each device runs the firmware's pump state machine (pumpcontrol.h) on a
+ * simulated well, and publishes state, HomeAssistant discovery and metrics
+ * through the same publish.h code the firmware uses. The firmware's topics
+ * are fixed per build (topics.h), so each device's topics get a fleet/devNNNN/
+ * prefix in place of a distinct MQTT_ROOT.
+ *
+ * An observer connection subscribes to fleet/# and $SYS/#. It matches every
+ * message to its publish to measure latency through the broker and counts
+ * what each device got delivered. Mosquitto's $SYS load figures are printed
+ * as they arrive.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <poll.h>
+#include <random>
+#include <signal.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mqttclient.h"
+#include "config.h"
+#include "homeassistant.hpp"
+#include "publish.h"
+#include "pumpcontrol.h"
+#include "telemetry.h"
+#include "textwriter.h"
+#include "topics.h"
+
+#define FLEET_PREFIX "fleet/"
+
+const uint32_t POLL_MS = 10000;       // POLL_SENSORS_MS in tasks.cpp
+const uint32_t DISCOVERY_MS = 5000;   // HA_DISCOVERY_MS in main.cpp
+const uint16_t KEEP_ALIVE_S = 60;
+
+// Metrics the firmware publishes every poll, then once a minute on top
+const TelemetryKey pollMetrics[] = {
+    TLM_CHECK_REQUEST_MS, TLM_DC_OFFSET_MV, TLM_READ_CT_MS, TLM_HISTORY_BYTES_SAMPLE,
+    TLM_LOOP_LATENESS_US, TLM_LOOP_JITTER_US, TLM_LOOP_EXEC_MS, TLM_LOOP_DEADLINE_MISSES,
+    TLM_ADC_MV, TLM_ADC_ADJUSTED_MV, TLM_ADC_VALUE
+};
+
+const TelemetryKey minuteMetrics[] = {
+    TLM_STACK_FREE_POLL, TLM_STACK_FREE_WIFI, TLM_STACK_FREE_BLINKER, TLM_STACK_FREE_LOOP,
+    TLM_RAM_STATIC_BYTES, TLM_HEAP_FREE, TLM_HEAP_MIN_FREE, TLM_HEAP_LARGEST_BLOCK,
+    TLM_LOOP_LATENESS_MAX_US, TLM_LOOP_JITTER_MAX_US
+};
+
+struct Options {
+    const char *host;
+    int port;
+    int devices;
+    double seconds;
+    double speed;
+    bool cbor;
+    int qos;           // -1 keeps the firmware's QoS
+    bool sync;
+    bool observer;
+    double reportS;
+    bool verbose;
+};
+
+struct Device {
+    int id;
+    char prefix[24];
+    MqttClient mqtt;
+    PublishSink sink;
+
+    PumpController ctl;
+    State state;
+    uint32_t polls;
+    bool demand;
+    uint32_t demandToggleMs;
+    bool dryRun;
+    std::mt19937 rng;
+
+    int64_t nextPollUs;
+    int64_t nextDiscoveryUs;
+
+    uint8_t frame[TELEMETRY_FRAME_BYTES];
+    MetricsFrame metrics;
+
+    uint64_t sent;
+    uint64_t delivered;
+};
+
+static Options opt;
+static int64_t startUs;
+
+// Publish times waiting for the observer, per full topic in publish order
+static std::unordered_map<std::string, std::deque<int64_t>> inFlight;
+static std::vector<int32_t> latencyUs;        // Since the last report
+static std::vector<int32_t> allLatencyUs;
+static uint64_t unmatched = 0;
+static uint64_t retainedSeen = 0;
+static std::map<std::string, std::string> sysValues;
+static std::vector<Device *> fleet;
+
+// Interval counters for the progress line
+static uint64_t intervalSent = 0;
+static uint64_t intervalBytes = 0;
+static uint64_t intervalDelivered = 0;
+
+static uint32_t simMs(int64_t nowUs) {
+    return (uint32_t)((nowUs - startUs) * opt.speed / 1000.0);
+}
+
+static int64_t realUs(uint32_t ms) {
+    return (int64_t)(ms * 1000.0 / opt.speed);
+}
+
+// Exponentially distributed gap with the given mean, in simulated ms
+static uint32_t expMs(Device *d, double meanMs) {
+    std::uniform_real_distribution<double> u(1e-9, 1.0);
+    return (uint32_t)(-log(u(d->rng)) * meanMs);
+}
+
+static void sinkPublish(void *ctx, const char *topic, uint8_t qos, bool retain, const uint8_t *payload, size_t len) {
+    Device *d = (Device *)ctx;
+    std::string full = std::string(d->prefix) + topic;
+
+    mqttClientPublish(&d->mqtt, full.c_str(), payload, len, opt.qos >= 0 ? opt.qos : qos, retain);
+    if(opt.observer) {
+        inFlight[full].push_back(monotonicUs());
+    }
+    d->sent++;
+    intervalSent++;
+    intervalBytes += full.size() + len;
+}
+
+static void publishMetric(Device *d, TelemetryKey key, float value) {
+    if(opt.cbor) {
+        if(!metricsFrameAdd(&d->metrics, key, value)) {
+            size_t len = telemetryEncodeMetrics(&d->metrics, simMs(monotonicUs()), d->frame, sizeof(d->frame));
+            if(len > 0) {
+                d->sink.publish(d->sink.ctx, Topics::CBOR_METRICS.s, 0, false, d->frame, len);
+            }
+            metricsFrameInit(&d->metrics);
+            metricsFrameAdd(&d->metrics, key, value);
+        }
+        return;
+    }
+
+    char v[24];
+    TextWriter w;
+    textWriterInit(&w, v, sizeof(v));
+    textWriteFixed(&w, value, 2);
+    publishText(&d->sink, telemetryTopic(key), 0, false, v);
+}
+
+static void flushMetrics(Device *d, uint32_t nowMs) {
+    if(opt.cbor && d->metrics.count > 0) {
+        size_t len = telemetryEncodeMetrics(&d->metrics, nowMs, d->frame, sizeof(d->frame));
+        if(len > 0) {
+            d->sink.publish(d->sink.ctx, Topics::CBOR_METRICS.s, 0, false, d->frame, len);
+        }
+        metricsFrameInit(&d->metrics);
+    }
+}
+
+// One taskPollSensors cycle: inputs, state machine, then everything it publishes
+static void devicePoll(Device *d, uint32_t nowMs) {
+    // Water requests come and go, about every half hour for a few minutes
+    if((int32_t)(nowMs - d->demandToggleMs) >= 0) {
+        d->demand = !d->demand;
+        d->demandToggleMs = nowMs + expMs(d, d->demand ? 8 * 60000.0 : 30 * 60000.0);
+    }
+    d->state.req1 = !d->demand;
+    d->state.req2 = true;
+
+    // The reading reflects the relay as it was, one start in twenty sucks air
+    std::normal_distribution<float> noise(0.0f, 25.0f);
+    float power = 0.0f;
+    if(d->state.pumpOn) {
+        power = (d->dryRun ? 1250.0f : 1600.0f) + noise(d->rng);
+    }
+    d->state.voltage = 120.0f;
+    d->state.current = power / 120.0f;
+    d->state.power = power;
+
+    char l[100];
+    snprintf(l, sizeof(l), "%3.2fV * %2.1fA = %4.1fW", d->state.voltage, d->state.current, d->state.power);
+    publishText(&d->sink, Topics::LOG.s, 0, false, l);
+
+    uint32_t logged = d->ctl.logCount;
+    pumpControlStep(&d->ctl, &d->state, nowMs);
+    for( ; logged < d->ctl.logCount; logged++) {
+        const PumpTransitionRecord *r = &d->ctl.log[logged % PUMP_LOG_SIZE];
+        if(r->to == PUMP_STARTING) {
+            d->dryRun = (d->rng() % 20 == 0);
+        }
+        snprintf(l, sizeof(l), "pump %s -> %s on %s at %lu ms", pumpStateName(r->from), pumpStateName(r->to),
+                 pumpEventName(r->event), (unsigned long)r->timeMs);
+        publishText(&d->sink, Topics::LOG.s, 0, false, l);
+    }
+
+    if(opt.cbor) {
+        publishStateCbor(&d->sink, &d->state, nowMs, d->frame, sizeof(d->frame));
+    } else {
+        publishStateText(&d->sink, &d->state);
+    }
+    publishHAState(&d->sink, &d->state);
+
+    std::uniform_real_distribution<float> value(0.0f, 1000.0f);
+    for(TelemetryKey k : pollMetrics) {
+        publishMetric(d, k, value(d->rng));
+    }
+    if(d->polls++ % 6 == 0) {
+        for(TelemetryKey k : minuteMetrics) {
+            publishMetric(d, k, value(d->rng));
+        }
+    }
+    flushMetrics(d, nowMs);
+}
+
+static void onDeviceMessage(MqttClient *c, const char *topic, const uint8_t *payload, size_t len, bool) {
+    Device *d = (Device *)c->user;
+    size_t prefixLen = strlen(d->prefix);
+    if(strncmp(topic, d->prefix, prefixLen) != 0 || !isOverrideTopic(topic + prefixLen)) {
+        return;
+    }
+    int event = overrideEvent((const char *)payload, len);
+    if(event >= 0) {
+        pumpControlEvent(&d->ctl, (PumpEvent)event, simMs(monotonicUs()));
+    }
+}
+
+static void onObserverMessage(MqttClient *, const char *topic, const uint8_t *payload, size_t len, bool retained) {
+    if(strncmp(topic, "$SYS/", 5) == 0) {
+        sysValues[topic] = std::string((const char *)payload, len);
+        return;
+    }
+    if(retained) {
+        retainedSeen++;
+        return;
+    }
+
+    auto it = inFlight.find(topic);
+    if(it == inFlight.end() || it->second.empty()) {
+        unmatched++;
+        return;
+    }
+    int64_t us = monotonicUs() - it->second.front();
+    it->second.pop_front();
+    latencyUs.push_back((int32_t)us);
+    allLatencyUs.push_back((int32_t)us);
+    intervalDelivered++;
+
+    int id = atoi(topic + strlen(FLEET_PREFIX "dev"));
+    if(id >= 0 && id < (int)fleet.size()) {
+        fleet[id]->delivered++;
+    }
+}
+
+static double percentileMs(std::vector<int32_t> &v, double p) {
+    if(v.empty()) {
+        return 0.0;
+    }
+    size_t k = std::min(v.size() - 1, (size_t)(p * v.size()));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k] / 1000.0;
+}
+
+static const char *sysValue(const char *topic) {
+    auto it = sysValues.find(topic);
+    return it != sysValues.end() ? it->second.c_str() : "-";
+}
+
+static void report(double elapsedS, double intervalS, size_t maxPending) {
+    printf("%6.0fs  sent %7.0f msg/s %8.1f kB/s  delivered %7.0f msg/s  latency p50 %6.2fms p99 %7.2fms max %7.2fms  backlog %zuB",
+           elapsedS, intervalSent / intervalS, intervalBytes / intervalS / 1000.0, intervalDelivered / intervalS,
+           percentileMs(latencyUs, 0.50), percentileMs(latencyUs, 0.99), percentileMs(latencyUs, 1.0), maxPending);
+    if(!sysValues.empty()) {
+        printf("  broker rx %s/min tx %s/min clients %s", sysValue("$SYS/broker/load/messages/received/1min"),
+               sysValue("$SYS/broker/load/messages/sent/1min"), sysValue("$SYS/broker/clients/connected"));
+    }
+    printf("\n");
+    fflush(stdout);
+
+    latencyUs.clear();
+    intervalSent = 0;
+    intervalBytes = 0;
+    intervalDelivered = 0;
+}
+
+// Wait for traffic until done() or the timeout, returns false if a connection dropped
+template<typename Done>
+static bool pump(MqttClient **clients, size_t n, int64_t untilUs, Done done) {
+    std::vector<struct pollfd> fds(n);
+    while(!done() && monotonicUs() < untilUs) {
+        int64_t now = monotonicUs();
+        for(size_t i = 0; i < n; i++) {
+            if(!mqttClientFlush(clients[i], now)) {
+                return false;
+            }
+            fds[i].fd = clients[i]->fd;
+            fds[i].events = POLLIN | (mqttClientPending(clients[i]) > 0 ? POLLOUT : 0);
+            fds[i].revents = 0;
+        }
+        poll(fds.data(), n, 10);
+        for(size_t i = 0; i < n; i++) {
+            if((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) && !mqttClientRead(clients[i])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--host H] [--port P] [--devices N] [--seconds S] [--speed X] [--cbor] [--qos Q]\n"
+                    "       [--sync] [--no-observer] [--report S] [-v]\n", argv0);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    opt.host = "127.0.0.1";
+    opt.port = 1883;
+    opt.devices = 100;
+    opt.seconds = 60.0;
+    opt.speed = 1.0;
+    opt.cbor = false;
+    opt.qos = -1;
+    opt.sync = false;
+    opt.observer = true;
+    opt.reportS = 10.0;
+    opt.verbose = false;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    for(int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if(strcmp(a, "--host") == 0 && hasValue) {
+            opt.host = argv[++i];
+        } else if(strcmp(a, "--port") == 0 && hasValue) {
+            opt.port = atoi(argv[++i]);
+        } else if(strcmp(a, "--devices") == 0 && hasValue) {
+            opt.devices = atoi(argv[++i]);
+        } else if(strcmp(a, "--seconds") == 0 && hasValue) {
+            opt.seconds = atof(argv[++i]);
+        } else if(strcmp(a, "--speed") == 0 && hasValue) {
+            opt.speed = atof(argv[++i]);
+        } else if(strcmp(a, "--cbor") == 0) {
+            opt.cbor = true;
+        } else if(strcmp(a, "--qos") == 0 && hasValue) {
+            opt.qos = atoi(argv[++i]);
+        } else if(strcmp(a, "--sync") == 0) {
+            opt.sync = true;
+        } else if(strcmp(a, "--no-observer") == 0) {
+            opt.observer = false;
+        } else if(strcmp(a, "--report") == 0 && hasValue) {
+            opt.reportS = atof(argv[++i]);
+        } else if(strcmp(a, "-v") == 0) {
+            opt.verbose = true;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if(opt.devices < 1 || opt.devices > 9999 || opt.speed <= 0.0 || opt.qos > 1) {
+        usage(argv[0]);
+    }
+
+    printf("%d devices on %s:%d, %s payloads, poll every %.2fs, discovery every %.2fs%s\n", opt.devices, opt.host,
+           opt.port, opt.cbor ? "CBOR" : "text", POLL_MS / 1000.0 / opt.speed, DISCOVERY_MS / 1000.0 / opt.speed,
+           opt.sync ? ", in lockstep" : "");
+
+    // The observer subscribes first so it sees every device's first message
+    MqttClient observer;
+    observer.onMessage = onObserverMessage;
+    observer.user = NULL;
+    if(opt.observer) {
+        if(!mqttClientOpen(&observer, opt.host, opt.port, "fleetsim-observer", KEEP_ALIVE_S)) {
+            fprintf(stderr, "unable to connect to %s:%d\n", opt.host, opt.port);
+            return 1;
+        }
+        mqttClientSubscribe(&observer, FLEET_PREFIX "#", 0);
+        mqttClientSubscribe(&observer, "$SYS/broker/#", 0);
+        MqttClient *o = &observer;
+        if(!pump(&o, 1, monotonicUs() + 5000000, [&] { return observer.connected && observer.pendingSubacks == 0; }) ||
+           !observer.connected) {
+            fprintf(stderr, "observer did not connect\n");
+            return 1;
+        }
+    }
+
+    std::vector<MqttClient *> clients;
+    for(int i = 0; i < opt.devices; i++) {
+        Device *d = new Device();
+        d->id = i;
+        snprintf(d->prefix, sizeof(d->prefix), FLEET_PREFIX "dev%04d/", i);
+        d->sink.publish = sinkPublish;
+        d->sink.ctx = d;
+        d->rng.seed(i + 1);
+        d->mqtt.onMessage = onDeviceMessage;
+        d->mqtt.user = d;
+
+        char clientId[32];
+        snprintf(clientId, sizeof(clientId), HOSTNAME "-%04d", i);
+        if(!mqttClientOpen(&d->mqtt, opt.host, opt.port, clientId, KEEP_ALIVE_S)) {
+            fprintf(stderr, "device %d unable to connect, check the broker's connection limit and ulimit -n\n", i);
+            return 1;
+        }
+
+        // Same subscriptions as onMqttConnect()
+        std::string t = std::string(d->prefix) + Topics::PUMP_OVERRIDE.s;
+        mqttClientSubscribe(&d->mqtt, t.c_str(), 1);
+        t = std::string(d->prefix) + Topics::HA_SWITCH_SET.s;
+        mqttClientSubscribe(&d->mqtt, t.c_str(), 1);
+
+        fleet.push_back(d);
+        clients.push_back(&d->mqtt);
+    }
+    if(opt.observer) {
+        clients.push_back(&observer);
+    }
+
+    bool ok = pump(clients.data(), clients.size(), monotonicUs() + 10000000, [&] {
+        for(Device *d : fleet) {
+            if(!d->mqtt.connected) {
+                return false;
+            }
+        }
+        return true;
+    });
+    if(!ok) {
+        fprintf(stderr, "a connection was refused or dropped while connecting\n");
+        return 1;
+    }
+
+    startUs = monotonicUs();
+    std::mt19937 spread(0);
+    for(Device *d : fleet) {
+        memset(&d->state, 0, sizeof(d->state));
+        d->state.req1 = true;
+        d->state.req2 = true;
+        pumpControlInit(&d->ctl, &pumpConfigDefault, 0);
+        metricsFrameInit(&d->metrics);
+        d->polls = 0;
+        d->demand = false;
+        d->demandToggleMs = expMs(d, 30 * 60000.0);
+        d->dryRun = false;
+        d->sent = 0;
+        d->delivered = 0;
+
+        // Devices boot at different times unless --sync
+        int64_t offset = opt.sync ? 0 : spread() % realUs(POLL_MS);
+        d->nextPollUs = startUs + offset;
+        d->nextDiscoveryUs = startUs + offset;
+    }
+
+    const int64_t endUs = startUs + (int64_t)(opt.seconds * 1e6);
+    int64_t nextReportUs = startUs + (int64_t)(opt.reportS * 1e6);
+    int64_t lastReportUs = startUs;
+    size_t maxPending = 0;
+    std::vector<struct pollfd> fds(clients.size());
+
+    while(true) {
+        int64_t now = monotonicUs();
+        if(now >= endUs) {
+            break;
+        }
+
+        int64_t nextUs = std::min(endUs, nextReportUs);
+        for(Device *d : fleet) {
+            if(now >= d->nextPollUs) {
+                devicePoll(d, simMs(now));
+                d->nextPollUs += realUs(POLL_MS);
+            }
+            if(now >= d->nextDiscoveryUs) {
+                char buf[HA_JSON_BYTES];
+                publishDiscovery(&d->sink, buf, sizeof(buf));
+                d->nextDiscoveryUs += realUs(DISCOVERY_MS);
+            }
+            nextUs = std::min(nextUs, std::min(d->nextPollUs, d->nextDiscoveryUs));
+        }
+
+        for(size_t i = 0; i < clients.size(); i++) {
+            mqttClientKeepAlive(clients[i], now);
+            if(!mqttClientFlush(clients[i], now)) {
+                fprintf(stderr, "connection %zu failed while sending\n", i);
+                return 1;
+            }
+            maxPending = std::max(maxPending, mqttClientPending(clients[i]));
+            fds[i].fd = clients[i]->fd;
+            fds[i].events = POLLIN | (mqttClientPending(clients[i]) > 0 ? POLLOUT : 0);
+            fds[i].revents = 0;
+        }
+
+        int timeoutMs = (int)std::max<int64_t>(0, (nextUs - monotonicUs() + 999) / 1000);
+        poll(fds.data(), fds.size(), timeoutMs);
+        for(size_t i = 0; i < clients.size(); i++) {
+            if((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) && !mqttClientRead(clients[i])) {
+                fprintf(stderr, "connection %zu dropped by the broker\n", i);
+                return 1;
+            }
+        }
+
+        now = monotonicUs();
+        if(now >= nextReportUs) {
+            report((now - startUs) / 1e6, (now - lastReportUs) / 1e6, maxPending);
+            lastReportUs = now;
+            nextReportUs += (int64_t)(opt.reportS * 1e6);
+            maxPending = 0;
+        }
+    }
+
+    // Send what is still queued, give the broker a moment to deliver it, then hang up
+    pump(clients.data(), clients.size(), monotonicUs() + 2000000, [&] {
+        for(MqttClient *c : clients) {
+            if(mqttClientPending(c) > 0) {
+                return false;
+            }
+        }
+        return true;
+    });
+    if(opt.observer) {
+        MqttClient *o = &observer;
+        pump(&o, 1, monotonicUs() + 2000000, [&] { return false; });
+    }
+    for(MqttClient *c : clients) {
+        mqttClientDisconnect(c);
+        mqttClientFlush(c, monotonicUs());
+        mqttClientClose(c);
+    }
+
+    uint64_t sent = 0, delivered = 0, bytes = 0, packets = 0;
+    uint64_t minSent = UINT64_MAX, maxSent = 0;
+    int shortDevices = 0;
+    for(Device *d : fleet) {
+        sent += d->sent;
+        delivered += d->delivered;
+        bytes += d->mqtt.sentBytes;
+        packets += d->mqtt.sentPackets;
+        minSent = std::min(minSent, d->sent);
+        maxSent = std::max(maxSent, d->sent);
+        if(opt.observer && d->delivered < d->sent) {
+            shortDevices++;
+        }
+        if(opt.verbose) {
+            printf("dev%04d  sent %8llu  delivered %8llu  %s\n", d->id, (unsigned long long)d->sent,
+                   (unsigned long long)d->delivered, pumpStateName(d->ctl.state));
+        }
+    }
+
+    double elapsedS = (monotonicUs() - startUs) / 1e6;
+    printf("\n%llu messages (%llu packets, %.1f MB on the wire) from %d devices in %.1fs, %.0f msg/s\n",
+           (unsigned long long)sent, (unsigned long long)packets, bytes / 1e6, opt.devices, elapsedS, sent / elapsedS);
+    printf("per device: %llu to %llu messages, %.1f msg/s each\n", (unsigned long long)minSent,
+           (unsigned long long)maxSent, (double)sent / opt.devices / elapsedS);
+    if(opt.observer) {
+        printf("delivered %llu (%.2f%%), %d devices short, %llu unmatched, %llu retained skipped\n",
+               (unsigned long long)delivered, sent > 0 ? 100.0 * delivered / sent : 0.0, shortDevices,
+               (unsigned long long)unmatched, (unsigned long long)retainedSeen);
+        printf("latency p50 %.2fms  p90 %.2fms  p99 %.2fms  p99.9 %.2fms  max %.2fms\n",
+               percentileMs(allLatencyUs, 0.50), percentileMs(allLatencyUs, 0.90), percentileMs(allLatencyUs, 0.99),
+               percentileMs(allLatencyUs, 0.999), percentileMs(allLatencyUs, 1.0));
+        for(auto &kv : sysValues) {
+            if(kv.first.find("/load/") != std::string::npos || kv.first.find("clients/connected") != std::string::npos ||
+               kv.first.find("dropped") != std::string::npos) {
+                printf("  %s %s\n", kv.first.c_str(), kv.second.c_str());
+            }
+        }
+    }
+    return 0;
+}
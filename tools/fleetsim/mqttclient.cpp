@@ -0,0 +1,272 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mqttclient.h"
+
+enum {
+    MQTT_CONNECT     = 0x10,
+    MQTT_CONNACK     = 0x20,
+    MQTT_PUBLISH     = 0x30,
+    MQTT_PUBACK      = 0x40,
+    MQTT_SUBSCRIBE   = 0x82,  // Reserved flags 0010
+    MQTT_SUBACK      = 0x90,
+    MQTT_PINGREQ     = 0xC0,
+    MQTT_PINGRESP    = 0xD0,
+    MQTT_DISCONNECT  = 0xE0
+};
+
+int64_t monotonicUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void putU16(std::vector<uint8_t> &b, uint16_t v) {
+    b.push_back(v >> 8);
+    b.push_back(v & 0xFF);
+}
+
+static void putString(std::vector<uint8_t> &b, const char *s, size_t len) {
+    putU16(b, (uint16_t)len);
+    b.insert(b.end(), s, s + len);
+}
+
+// Fixed header with the variable length remaining length
+static void putHeader(MqttClient *c, uint8_t type, size_t remaining) {
+    c->out.push_back(type);
+    do {
+        uint8_t byte = remaining & 0x7F;
+        remaining >>= 7;
+        if(remaining > 0) {
+            byte |= 0x80;
+        }
+        c->out.push_back(byte);
+    } while(remaining > 0);
+    c->sentPackets++;
+}
+
+static uint16_t nextPacketId(MqttClient *c) {
+    if(++c->nextId == 0) {
+        c->nextId = 1;
+    }
+    return c->nextId;
+}
+
+bool mqttClientOpen(MqttClient *c, const char *host, int port, const char *clientId, uint16_t keepAliveS) {
+    c->fd = -1;
+    c->connected = false;
+    c->keepAliveS = keepAliveS;
+    c->nextId = 0;
+    c->inflight = 0;
+    c->pendingSubacks = 0;
+    c->lastSendUs = monotonicUs();
+    c->out.clear();
+    c->outPos = 0;
+    c->in.clear();
+    c->sentPackets = 0;
+    c->sentBytes = 0;
+
+    char portStr[8];
+    snprintf(portStr, sizeof(portStr), "%d", port);
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *res = NULL;
+    if(getaddrinfo(host, portStr, &hints, &res) != 0) {
+        return false;
+    }
+    for(struct addrinfo *a = res; a != NULL && c->fd < 0; a = a->ai_next) {
+        c->fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if(c->fd >= 0 && connect(c->fd, a->ai_addr, a->ai_addrlen) != 0) {
+            close(c->fd);
+            c->fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if(c->fd < 0) {
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL) | O_NONBLOCK);
+
+    // Clean session, no will, no credentials
+    std::vector<uint8_t> body;
+    putString(body, "MQTT", 4);
+    body.push_back(4);      // Protocol level 3.1.1
+    body.push_back(0x02);   // Clean session
+    putU16(body, keepAliveS);
+    putString(body, clientId, strlen(clientId));
+
+    putHeader(c, MQTT_CONNECT, body.size());
+    c->out.insert(c->out.end(), body.begin(), body.end());
+    return true;
+}
+
+void mqttClientClose(MqttClient *c) {
+    if(c->fd >= 0) {
+        close(c->fd);
+        c->fd = -1;
+    }
+    c->connected = false;
+}
+
+void mqttClientPublish(MqttClient *c, const char *topic, const uint8_t *payload, size_t len, uint8_t qos, bool retain) {
+    size_t topicLen = strlen(topic);
+    putHeader(c, MQTT_PUBLISH | (qos > 0 ? 0x02 : 0) | (retain ? 0x01 : 0), 2 + topicLen + (qos > 0 ? 2 : 0) + len);
+    putString(c->out, topic, topicLen);
+    if(qos > 0) {
+        putU16(c->out, nextPacketId(c));
+        c->inflight++;
+    }
+    c->out.insert(c->out.end(), payload, payload + len);
+}
+
+void mqttClientSubscribe(MqttClient *c, const char *topic, uint8_t qos) {
+    size_t topicLen = strlen(topic);
+    putHeader(c, MQTT_SUBSCRIBE, 2 + 2 + topicLen + 1);
+    putU16(c->out, nextPacketId(c));
+    putString(c->out, topic, topicLen);
+    c->out.push_back(qos);
+    c->pendingSubacks++;
+}
+
+void mqttClientDisconnect(MqttClient *c) {
+    putHeader(c, MQTT_DISCONNECT, 0);
+}
+
+void mqttClientKeepAlive(MqttClient *c, int64_t nowUs) {
+    if(c->keepAliveS > 0 && nowUs - c->lastSendUs > (int64_t)c->keepAliveS * 500000) {
+        putHeader(c, MQTT_PINGREQ, 0);
+        c->lastSendUs = nowUs;
+    }
+}
+
+size_t mqttClientPending(const MqttClient *c) {
+    return c->out.size() - c->outPos;
+}
+
+bool mqttClientFlush(MqttClient *c, int64_t nowUs) {
+    while(c->outPos < c->out.size()) {
+        ssize_t n = send(c->fd, c->out.data() + c->outPos, c->out.size() - c->outPos, 0);
+        if(n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        c->outPos += n;
+        c->sentBytes += n;
+        c->lastSendUs = nowUs;
+    }
+    c->out.clear();
+    c->outPos = 0;
+    return true;
+}
+
+static bool handlePacket(MqttClient *c, uint8_t type, const uint8_t *p, size_t len) {
+    switch(type & 0xF0) {
+    case MQTT_CONNACK:
+        if(len < 2 || p[1] != 0) {
+            fprintf(stderr, "mqtt: connection refused, code %d\n", len >= 2 ? p[1] : -1);
+            return false;
+        }
+        c->connected = true;
+        return true;
+    case MQTT_PUBACK:
+        if(c->inflight > 0) {
+            c->inflight--;
+        }
+        return true;
+    case MQTT_SUBACK:
+        if(c->pendingSubacks > 0) {
+            c->pendingSubacks--;
+        }
+        return true;
+    case MQTT_PINGRESP:
+        return true;
+    case MQTT_PUBLISH: {
+        uint8_t qos = (type >> 1) & 0x03;
+        if(len < 2) {
+            return false;
+        }
+        size_t topicLen = (p[0] << 8) | p[1];
+        size_t at = 2 + topicLen + (qos > 0 ? 2 : 0);
+        if(at > len || topicLen > 255) {
+            return false;
+        }
+        char topic[256];
+        memcpy(topic, p + 2, topicLen);
+        topic[topicLen] = '\0';
+
+        if(qos > 0) {
+            putHeader(c, MQTT_PUBACK, 2);
+            c->out.push_back(p[2 + topicLen]);
+            c->out.push_back(p[3 + topicLen]);
+        }
+        if(c->onMessage != NULL) {
+            c->onMessage(c, topic, p + at, len - at, (type & 0x01) != 0);
+        }
+        return true;
+    }
+    default:
+        fprintf(stderr, "mqtt: unexpected packet 0x%02x\n", type);
+        return false;
+    }
+}
+
+bool mqttClientRead(MqttClient *c) {
+    uint8_t buf[16384];
+    while(true) {
+        ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+        if(n == 0) {
+            return false;
+        }
+        if(n < 0) {
+            if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                break;
+            }
+            return false;
+        }
+        c->in.insert(c->in.end(), buf, buf + n);
+    }
+
+    // Handle every complete packet, keep a partial one for next time
+    size_t pos = 0;
+    while(c->in.size() - pos >= 2) {
+        size_t remaining = 0;
+        size_t at = pos + 1;
+        int shift = 0;
+        bool complete = false;
+        while(at < c->in.size() && shift <= 21) {
+            uint8_t byte = c->in[at++];
+            remaining |= (size_t)(byte & 0x7F) << shift;
+            shift += 7;
+            if((byte & 0x80) == 0) {
+                complete = true;
+                break;
+            }
+        }
+        if(!complete) {
+            if(shift > 21) {
+                return false;
+            }
+            break;
+        }
+        if(c->in.size() - at < remaining) {
+            break;
+        }
+        if(!handlePacket(c, c->in[pos], c->in.data() + at, remaining)) {
+            return false;
+        }
+        pos = at + remaining;
+    }
+    c->in.erase(c->in.begin(), c->in.begin() + pos);
+    return true;
+}
@@ -0,0 +1,63 @@
+/* mqttclient.h - just enough MQTT 3.1.1 over a POSIX socket for fleetsim
+ *
+ * One non-blocking connection per client. Packets are queued in out and
+ * written by mqttClientFlush() when poll() says the socket can take them,
+ * received bytes are parsed by mqttClientRead(). QoS 0 and 1 only. The
+ * caller ignores SIGPIPE, MSG_NOSIGNAL isn't there on macOS.
+ */
+#ifndef FLEETSIM_MQTTCLIENT_H
+#define FLEETSIM_MQTTCLIENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+struct MqttClient;
+
+// A PUBLISH arrived, topic is NUL terminated, retained is set for messages
+// the broker had stored before the subscription
+typedef void (*MqttOnMessage)(MqttClient *c, const char *topic, const uint8_t *payload, size_t len, bool retained);
+
+struct MqttClient {
+    int fd;
+    bool connected;          // CONNACK accepted
+    uint16_t keepAliveS;
+    uint16_t nextId;
+    uint32_t inflight;       // QoS 1 publishes waiting for PUBACK
+    uint32_t pendingSubacks;
+    int64_t lastSendUs;
+
+    std::vector<uint8_t> out;
+    size_t outPos;
+    std::vector<uint8_t> in;
+
+    MqttOnMessage onMessage;
+    void *user;
+
+    uint64_t sentPackets;
+    uint64_t sentBytes;
+};
+
+// Blocking TCP connect, then the socket is made non-blocking and CONNECT is queued
+bool mqttClientOpen(MqttClient *c, const char *host, int port, const char *clientId, uint16_t keepAliveS);
+void mqttClientClose(MqttClient *c);
+
+void mqttClientPublish(MqttClient *c, const char *topic, const uint8_t *payload, size_t len, uint8_t qos, bool retain);
+void mqttClientSubscribe(MqttClient *c, const char *topic, uint8_t qos);
+void mqttClientDisconnect(MqttClient *c);
+
+// PINGREQ once half the keep alive has passed without sending
+void mqttClientKeepAlive(MqttClient *c, int64_t nowUs);
+
+// Bytes queued but not yet written
+size_t mqttClientPending(const MqttClient *c);
+
+// Write queued bytes, returns false if the connection failed
+bool mqttClientFlush(MqttClient *c, int64_t nowUs);
+
+// Read and handle whatever arrived, returns false on EOF or a protocol error
+bool mqttClientRead(MqttClient *c);
+
+int64_t monotonicUs();
+
+#endif /* !FLEETSIM_MQTTCLIENT_H */
@@ -0,0 +1,246 @@
+/* history_bench - native benchmark for the history column encoders
+ *
+ * Reports bytes per sample and encode/decode throughput for the
+ * delta-of-delta + XOR and the delta-of-delta + zig-zag varint layouts.
+ *
+ * Usage: history_bench [trace.csv ...]
+ *
+ * Each CSV line is "t_ms,power_watts,current_amps". Without arguments a
+ * synthetic pump trace (off, running and dry-run band) is generated.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "history.h"
+
+struct Sample {
+    uint32_t t;
+    float power;
+    float current;
+};
+
+static const double vRMS = 120.0;
+
+// Mimic readCTApparentPower(): current is a double RMS that gets truncated
+// to float, power is vRMS * current and readings below 0.5A are zeroed.
+static Sample makeSample(uint32_t t, double iRMS) {
+    if(iRMS < 0.5) {
+        iRMS = 0.0;
+    }
+    Sample s;
+    s.t = t;
+    s.current = (float)iRMS;
+    s.power = (float)(vRMS * iRMS);
+    return s;
+}
+
+static std::vector<Sample> syntheticTrace(size_t n) {
+    std::mt19937 rng(42);
+    std::normal_distribution<double> noise(0.0, 0.05);
+    std::uniform_int_distribution<int> jitter(-15, 15);
+    std::uniform_int_distribution<int> runLength(6, 90);
+
+    std::vector<Sample> trace;
+    trace.reserve(n);
+
+    uint32_t t = 0;
+    int phase = 0;      // 0 = off, 1 = running, 2 = dry-run band
+    int remaining = runLength(rng);
+
+    while(trace.size() < n) {
+        double level = 0.0;
+        if(phase == 1) {
+            level = 15.5;   // ~1860W
+        } else if(phase == 2) {
+            level = 10.4;   // ~1250W, inside badLoadWattsLow/High
+        }
+
+        trace.push_back(makeSample(t, level > 0 ? level + noise(rng) : fabs(noise(rng))));
+        t += 10000 + 120 + jitter(rng); // 10s poll plus capture time and scheduling jitter
+
+        if(--remaining <= 0) {
+            phase = (phase == 0) ? ((rng() % 8) == 0 ? 2 : 1) : 0;
+            remaining = runLength(rng);
+        }
+    }
+    return trace;
+}
+
+static bool loadCsv(const char *path, std::vector<Sample> *trace) {
+    FILE *f = fopen(path, "r");
+    if(f == NULL) {
+        fprintf(stderr, "unable to open %s\n", path);
+        return false;
+    }
+
+    unsigned long t;
+    float p, c;
+    char line[128];
+    while(fgets(line, sizeof(line), f)) {
+        if(sscanf(line, "%lu,%f,%f", &t, &p, &c) == 3) {
+            Sample s = { (uint32_t)t, p, c };
+            trace->push_back(s);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Split the trace into blocks the size a HistoryBlock would hold on the device
+struct Encoded {
+    std::vector<uint8_t> time;
+    std::vector<uint8_t> power;
+    std::vector<uint8_t> current;
+    size_t count;
+};
+
+static void benchXor(const std::vector<Sample> &trace, int rounds) {
+    std::vector<Encoded> blocks;
+    size_t bytes = 0;
+
+    Clock::time_point start = Clock::now();
+    for(int r = 0; r < rounds; r++) {
+        blocks.clear();
+        bytes = 0;
+
+        HistoryBlock b;
+        historyBlockInit(&b);
+        for(size_t i = 0; i <= trace.size(); i++) {
+            bool last = (i == trace.size());
+            if(last || !historyBlockAppend(&b, trace[i].t, trace[i].power, trace[i].current)) {
+                Encoded e;
+                e.time.assign(b.timeBuf, b.timeBuf + bitWriterBytes(&b.time.w));
+                e.power.assign(b.powerBuf, b.powerBuf + bitWriterBytes(&b.power.w));
+                e.current.assign(b.currentBuf, b.currentBuf + bitWriterBytes(&b.current.w));
+                e.count = b.count;
+                bytes += historyBlockBytes(&b);
+                blocks.push_back(e);
+
+                historyBlockInit(&b);
+                if(!last) {
+                    historyBlockAppend(&b, trace[i].t, trace[i].power, trace[i].current);
+                }
+            }
+        }
+    }
+    double encodeSec = secondsSince(start);
+
+    size_t mismatches = 0;
+    start = Clock::now();
+    for(int r = 0; r < rounds; r++) {
+        size_t i = 0;
+        for(size_t k = 0; k < blocks.size(); k++) {
+            TimeDecoder td;
+            XorDecoder pd, cd;
+            timeDecoderInit(&td, blocks[k].time.data(), blocks[k].time.size());
+            xorDecoderInit(&pd, blocks[k].power.data(), blocks[k].power.size());
+            xorDecoderInit(&cd, blocks[k].current.data(), blocks[k].current.size());
+
+            for(size_t j = 0; j < blocks[k].count; j++, i++) {
+                uint32_t t;
+                float p, c;
+                timeDecoderNext(&td, &t);
+                xorDecoderNext(&pd, &p);
+                xorDecoderNext(&cd, &c);
+                if(t != trace[i].t || p != trace[i].power || c != trace[i].current) {
+                    mismatches++;
+                }
+            }
+        }
+    }
+    double decodeSec = secondsSince(start);
+
+    double samples = (double)trace.size() * rounds;
+    printf("%-14s %8.2f B/sample  %8.2f Msamples/s encode  %8.2f Msamples/s decode  %zu blocks  %zu mismatches\n",
+           "dod+xor", (double)bytes / trace.size(), samples / encodeSec / 1e6, samples / decodeSec / 1e6,
+           blocks.size(), mismatches / rounds);
+}
+
+static void benchVarint(const std::vector<Sample> &trace, int rounds) {
+    const float powerScale = 10.0f;     // 0.1W resolution
+    const float currentScale = 100.0f;  // 0.01A resolution
+
+    std::vector<uint8_t> timeBuf(trace.size() * 8 + 16);
+    std::vector<uint8_t> powerBuf(trace.size() * 5);
+    std::vector<uint8_t> currentBuf(trace.size() * 5);
+    size_t bytes = 0;
+
+    TimeEncoder te;
+    VarintEncoder pe, ce;
+
+    Clock::time_point start = Clock::now();
+    for(int r = 0; r < rounds; r++) {
+        timeEncoderInit(&te, timeBuf.data(), timeBuf.size());
+        varintEncoderInit(&pe, powerBuf.data(), powerBuf.size(), powerScale);
+        varintEncoderInit(&ce, currentBuf.data(), currentBuf.size(), currentScale);
+        for(size_t i = 0; i < trace.size(); i++) {
+            timeEncoderAppend(&te, trace[i].t);
+            varintEncoderAppend(&pe, trace[i].power);
+            varintEncoderAppend(&ce, trace[i].current);
+        }
+        bytes = bitWriterBytes(&te.w) + pe.len + ce.len;
+    }
+    double encodeSec = secondsSince(start);
+
+    double maxPowerErr = 0.0;
+    double maxCurrentErr = 0.0;
+    start = Clock::now();
+    for(int r = 0; r < rounds; r++) {
+        TimeDecoder td;
+        VarintDecoder pd, cd;
+        timeDecoderInit(&td, timeBuf.data(), bitWriterBytes(&te.w));
+        varintDecoderInit(&pd, powerBuf.data(), pe.len, powerScale);
+        varintDecoderInit(&cd, currentBuf.data(), ce.len, currentScale);
+
+        for(size_t i = 0; i < trace.size(); i++) {
+            uint32_t t;
+            float p, c;
+            timeDecoderNext(&td, &t);
+            varintDecoderNext(&pd, &p);
+            varintDecoderNext(&cd, &c);
+            maxPowerErr = fmax(maxPowerErr, fabs(p - trace[i].power));
+            maxCurrentErr = fmax(maxCurrentErr, fabs(c - trace[i].current));
+        }
+    }
+    double decodeSec = secondsSince(start);
+
+    double samples = (double)trace.size() * rounds;
+    printf("%-14s %8.2f B/sample  %8.2f Msamples/s encode  %8.2f Msamples/s decode  max err %.3fW %.4fA\n",
+           "dod+varint", (double)bytes / trace.size(), samples / encodeSec / 1e6, samples / decodeSec / 1e6,
+           maxPowerErr, maxCurrentErr);
+}
+
+int main(int argc, char **argv) {
+    std::vector<Sample> trace;
+
+    if(argc > 1) {
+        for(int i = 1; i < argc; i++) {
+            if(!loadCsv(argv[i], &trace)) {
+                return 1;
+            }
+        }
+    } else {
+        trace = syntheticTrace(100000);
+    }
+
+    if(trace.empty()) {
+        fprintf(stderr, "no samples\n");
+        return 1;
+    }
+
+    const int rounds = 20;
+    printf("%zu samples, raw %zu B/sample\n", trace.size(), sizeof(uint32_t) + 2 * sizeof(float));
+    benchXor(trace, rounds);
+    benchVarint(trace, rounds);
+    return 0;
+}
@@ -0,0 +1,222 @@
+/* pumpctl - prints and checks the pump control transition table
+ *
+ *   pumpctl [--walk N] [--seed S]
+ *
+ * Prints pumpTransitions as a state x event matrix, then fires every event
+ * in every state with its guard both holding and failing, then runs a
+ * random walk of N events (default 1000000). After every event it checks:
+ *   - the relay matches the state (closed in starting/running/suspect, open
+ *     in idle/backoff, the override in manual)
+ *   - the relay never opens before minRunMs or closes before minRestMs,
+ *     except when a dry run starts a backoff or on a manual command
+ *   - backoff is never left before it expires except on a manual command,
+ *     and never with the relay closed
+ *   - notOkLimit dry-run readings with the relay closed start a backoff,
+ *     in manual too
+ * and across the whole walk:
+ *   - the relay is never closed before backoffUntilMs, however the events
+ *     in between were ordered
+ * Exits 1 if any check fails.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#include "pumpcontrol.h"
+
+static const char *guardNames[] = { "", "min-run", "min-rest", "expired" };
+static const char *actionNames[] = { "", "backoff", "on", "off" };
+
+static bool expectedRelay(const PumpController *ctl) {
+    switch(ctl->state) {
+    case PUMP_STARTING:
+    case PUMP_RUNNING:
+    case PUMP_SUSPECT:
+        return true;
+    case PUMP_MANUAL:
+        return ctl->manualRelay;
+    default:
+        return false;
+    }
+}
+
+static bool isManual(uint8_t event) {
+    return event == PUMP_EV_MANUAL_ON || event == PUMP_EV_MANUAL_OFF || event == PUMP_EV_MANUAL_RELEASE;
+}
+
+static uint64_t violations = 0;
+
+static void fail(const char *what, const PumpController *before, const PumpController *after,
+                 uint8_t event, uint32_t nowMs) {
+    printf("VIOLATION: %s\n  t=%u  %s -> %s on %s  relay %d -> %d  relayChanged %u  backoffUntil %u\n",
+           what, nowMs, pumpStateName(before->state), pumpStateName(after->state), pumpEventName(event),
+           before->relay, after->relay, before->relayChangedMs, before->backoffUntilMs);
+    violations++;
+}
+
+// Check one event against the invariants, before is the controller as it
+// was before the event went in
+static void checkEvent(const PumpController *before, const PumpController *after, uint8_t event, uint32_t nowMs) {
+    const PumpConfig *cfg = before->cfg;
+
+    if(after->relay != expectedRelay(after)) {
+        fail("relay does not match state", before, after, event, nowMs);
+    }
+
+    bool exempt = isManual(event) || before->state == PUMP_MANUAL;
+    if(before->relay && !after->relay && !exempt && after->state != PUMP_BACKOFF &&
+       nowMs - before->relayChangedMs < cfg->minRunMs) {
+        fail("relay opened before minRunMs", before, after, event, nowMs);
+    }
+    if(!before->relay && after->relay && !exempt && nowMs - before->relayChangedMs < cfg->minRestMs) {
+        fail("relay closed before minRestMs", before, after, event, nowMs);
+    }
+
+    if(before->state == PUMP_BACKOFF && after->state != PUMP_BACKOFF &&
+       (int32_t)(nowMs - before->backoffUntilMs) < 0 && (!isManual(event) || after->relay)) {
+        fail("backoff left before it expired", before, after, event, nowMs);
+    }
+
+    if(event == PUMP_EV_POWER_BAD_LIMIT && before->relay && after->state != PUMP_BACKOFF) {
+        fail("dry run did not start a backoff", before, after, event, nowMs);
+    }
+}
+
+static void printTable() {
+    printf("%-9s", "");
+    for(int e = 0; e < PUMP_EVENT_COUNT; e++) {
+        printf(" %-16s", pumpEventName(e));
+    }
+    printf("\n");
+
+    for(int s = 0; s < PUMP_STATE_COUNT; s++) {
+        printf("%-9s", pumpStateName(s));
+        for(int e = 0; e < PUMP_EVENT_COUNT; e++) {
+            const PumpTransition *t = &pumpTransitions[s][e];
+            char cell[48];
+            if(t->next == s && t->guard == PUMP_GUARD_NONE && t->action == PUMP_ACT_NONE) {
+                strcpy(cell, ".");
+            } else {
+                snprintf(cell, sizeof(cell), "%s%s%s%s%s", pumpStateName(t->next),
+                         t->guard ? " ?" : "", guardNames[t->guard],
+                         t->action ? " !" : "", actionNames[t->action]);
+            }
+            printf(" %-16s", cell);
+        }
+        printf("\n");
+    }
+    printf("(. stays, ?guard must hold, !action runs)\n\n");
+}
+
+// Every state x event x guard outcome, from both manual relay settings
+static uint64_t checkExhaustive(const PumpConfig *cfg) {
+    const uint32_t now = 1000000000;
+    const uint32_t longest = cfg->minRunMs > cfg->minRestMs ? cfg->minRunMs : cfg->minRestMs;
+    uint64_t cases = 0;
+
+    for(int s = 0; s < PUMP_STATE_COUNT; s++) {
+        for(int e = 0; e < PUMP_EVENT_COUNT; e++) {
+            for(int holds = 0; holds < 2; holds++) {
+                for(int manual = 0; manual < 2; manual++) {
+                    PumpController ctl;
+                    pumpControlInit(&ctl, cfg, now);
+                    ctl.state = s;
+                    ctl.manualRelay = manual;
+                    ctl.relay = expectedRelay(&ctl);
+                    ctl.relayChangedMs = holds ? now - longest : now - 1;
+                    ctl.backoffUntilMs = holds ? now : now + 1;
+
+                    const PumpTransition *t = &pumpTransitions[s][e];
+                    bool guarded = (t->guard != PUMP_GUARD_NONE);
+                    uint8_t expected = (!guarded || holds) ? t->next : s;
+
+                    PumpController before = ctl;
+                    bool changed = pumpControlEvent(&ctl, (PumpEvent)e, now);
+                    cases++;
+
+                    if(ctl.state != expected) {
+                        fail("table transition not taken", &before, &ctl, e, now);
+                    }
+                    if(changed != (ctl.state != s || ctl.relay != before.relay)) {
+                        fail("return value does not match state or relay change", &before, &ctl, e, now);
+                    }
+                    if(changed != (ctl.logCount == 1)) {
+                        fail("transition not logged", &before, &ctl, e, now);
+                    }
+                    checkEvent(&before, &ctl, e, now);
+                }
+            }
+        }
+    }
+    return cases;
+}
+
+// Random events with mostly short gaps so the guards are hit both ways.
+// Starts near the top of the millis() range so the walk wraps.
+static void checkWalk(const PumpConfig *cfg, uint64_t steps, uint32_t seed, uint64_t *visits) {
+    std::mt19937 rng(seed);
+    uint32_t now = 0xF0000000u;
+
+    PumpController ctl;
+    pumpControlInit(&ctl, cfg, now);
+
+    for(uint64_t i = 0; i < steps && violations < 10; i++) {
+        uint32_t r = rng() % 1000;
+        now += r < 990 ? rng() % 20000 : rng() % (2 * cfg->backoffMs);
+
+        // Overrides are rare on the device, keep them rare here
+        uint8_t event = rng() % PUMP_EVENT_COUNT;
+        if((event == PUMP_EV_MANUAL_ON || event == PUMP_EV_MANUAL_OFF) && rng() % 20) {
+            event = PUMP_EV_TICK;
+        }
+
+        PumpController before = ctl;
+        pumpControlEvent(&ctl, (PumpEvent)event, now);
+        checkEvent(&before, &ctl, event, now);
+        if(ctl.relay && (int32_t)(now - ctl.backoffUntilMs) < 0) {
+            fail("relay closed during a backoff", &before, &ctl, event, now);
+        }
+        visits[ctl.state]++;
+    }
+}
+
+int main(int argc, char **argv) {
+    uint64_t steps = 1000000;
+    uint32_t seed = 1;
+
+    for(int i = 1; i < argc; i++) {
+        bool hasValue = (i + 1 < argc);
+        if(strcmp(argv[i], "--walk") == 0 && hasValue) {
+            steps = strtoull(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--walk N] [--seed S]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const PumpConfig *cfg = &pumpConfigDefault;
+    printf("min run %us  min rest %us  backoff %us\n\n", cfg->minRunMs / 1000, cfg->minRestMs / 1000,
+           cfg->backoffMs / 1000);
+    printTable();
+
+    uint64_t cases = checkExhaustive(cfg);
+    printf("exhaustive: %llu cases\n", (unsigned long long)cases);
+
+    uint64_t visits[PUMP_STATE_COUNT] = { 0 };
+    checkWalk(cfg, steps, seed, visits);
+    printf("walk: %llu events, seed %u, events ending in", (unsigned long long)steps, seed);
+    for(int s = 0; s < PUMP_STATE_COUNT; s++) {
+        printf(" %s %llu", pumpStateName(s), (unsigned long long)visits[s]);
+    }
+    printf("\n");
+
+    if(violations) {
+        printf("%llu violations\n", (unsigned long long)violations);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
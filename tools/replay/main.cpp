@@ -0,0 +1,312 @@
+/* replay - push recorded ADC traces through the pump decision pipeline
+ *
+ * Runs every record of a trace through ctApparentPower -> pumpControlStep,
+ * the same code taskPollSensors runs on the device, and reports the state
+ * transitions, per-stage timings and overall throughput.
+ *
+ * Record a trace with TRACE_RECORDING enabled in config.h and
+ *   mosquitto_sub -h homeassistant.local -t well/monitor/trace -N > day.trc
+ *
+ * Usage:
+ *   replay [options] trace.trc [trace.trc ...]
+ *   replay --synth HOURS out.trc      write a synthetic trace to test with
+ *
+ * Options:
+ *   --offset V        start the DC offset tracker from V, as after a warm boot
+ *   --low W           badLoadWattsLow
+ *   --high W          badLoadWattsHigh
+ *   --limit N         consecutive bad readings before backoff
+ *   --noise A         noise floor in Amps
+ *   --backoff S       backoff period in seconds
+ *   --min-run S       minimum run time in seconds
+ *   --min-rest S      minimum rest time in seconds
+ *   --repeat N        replay the traces N times (throughput measurement)
+ *   -v                print every record, not only state transitions
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "pumplogic.h"
+#include "pumpcontrol.h"
+#include "trace.h"
+
+#define MAX_SAMPLES 4096
+
+typedef std::chrono::steady_clock Clock;
+
+static uint64_t nanosSince(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> *data) {
+    FILE *f = fopen(path, "rb");
+    if(f == NULL) {
+        fprintf(stderr, "unable to open %s\n", path);
+        return false;
+    }
+
+    uint8_t buf[65536];
+    size_t n;
+    while((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data->insert(data->end(), buf, buf + n);
+    }
+    fclose(f);
+    return true;
+}
+
+// A day of 10 second polls with the pump cycling and the odd dry run.
+// Samples are a 60Hz sine around the divider offset, like the CT produces,
+// with the offset drifting over the day as the divider warms and cools.
+// The relay follows the default pipeline so a default replay agrees with it.
+static int synthesize(double hours, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if(f == NULL) {
+        fprintf(stderr, "unable to open %s\n", path);
+        return 1;
+    }
+
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(0.0, 4.0);
+    std::uniform_int_distribution<int> runLength(6, 90);
+
+    const size_t n = 1000;
+    const double sampleUs = 45.0;            // analogReadMilliVolts() rate
+    const double mvPerAmp = 200.0 / 2000.0 * 1000.0;
+
+    std::vector<uint16_t> samples(n);
+    std::vector<uint8_t> out(traceRecordMaxBytes(n));
+
+    uint32_t polls = (uint32_t)(hours * 360);
+    uint32_t t = 0;
+    int phase = 0;   // 0 = idle, 1 = running, 2 = dry run
+    int remaining = runLength(rng);
+    bool relay = false;
+
+    State state;
+    memset(&state, 0, sizeof(state));
+    state.pumpOk = true;
+
+    DcTracker dc;
+    dcTrackerInit(&dc, &pumpConfigDefault);
+
+    PumpController ctl;
+    pumpControlInit(&ctl, &pumpConfigDefault, t);
+
+    for(uint32_t k = 0; k < polls; k++) {
+        double amps = 0.0;
+        if(phase == 1) {
+            amps = 15.5;
+        } else if(phase == 2) {
+            amps = 10.4;
+        }
+        if(!relay) {
+            amps = 0.0;
+        }
+
+        double bias = 1644.0 + 25.0 * sin(2 * M_PI * t / 86400000.0);
+        double phi = std::uniform_real_distribution<double>(0, 2 * M_PI)(rng);
+        for(size_t i = 0; i < n; i++) {
+            double v = bias + amps * sqrt(2.0) * mvPerAmp * sin(phi + 2 * M_PI * 60.0 * i * sampleUs / 1e6) + noise(rng);
+            samples[i] = (uint16_t)fmax(0.0, fmin(3300.0, v));
+        }
+
+        TraceRecord rec;
+        rec.timeMs = t;
+        rec.captureUs = (uint32_t)(n * sampleUs);
+        rec.numSamples = n;
+        rec.flags = (phase == 0 ? TRACE_FLAG_REQ_1 | TRACE_FLAG_REQ_2 : 0) | (relay ? TRACE_FLAG_RELAY : 0)
+                  | (state.backoff ? TRACE_FLAG_BACKOFF : 0);
+
+        size_t len = traceEncode(&rec, samples.data(), out.data(), out.size());
+        fwrite(out.data(), 1, len, f);
+
+        state.req1 = rec.flags & TRACE_FLAG_REQ_1;
+        state.req2 = rec.flags & TRACE_FLAG_REQ_2;
+        ctApparentPower(&pumpConfigDefault, &dc, samples.data(), n, &state);
+        pumpControlStep(&ctl, &state, rec.timeMs);
+        relay = state.pumpOn;
+
+        t += 10000 + rec.captureUs / 1000;
+        if(--remaining <= 0) {
+            phase = (phase == 0) ? ((rng() % 6) == 0 ? 2 : 1) : 0;
+            remaining = runLength(rng);
+        }
+    }
+
+    fclose(f);
+    printf("wrote %u records (%.1f hours) to %s\n", polls, hours, path);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    PumpConfig cfg = pumpConfigDefault;
+    std::vector<const char*> paths;
+    bool warmStart = false;
+    int repeat = 1;
+    bool verbose = false;
+
+    for(int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if(strcmp(a, "--synth") == 0 && i + 2 < argc) {
+            return synthesize(atof(argv[i + 1]), argv[i + 2]);
+        } else if(strcmp(a, "--offset") == 0 && hasValue) {
+            cfg.offset = atof(argv[++i]);
+            warmStart = true;
+        } else if(strcmp(a, "--low") == 0 && hasValue) {
+            cfg.badLoadWattsLow = atof(argv[++i]);
+        } else if(strcmp(a, "--high") == 0 && hasValue) {
+            cfg.badLoadWattsHigh = atof(argv[++i]);
+        } else if(strcmp(a, "--limit") == 0 && hasValue) {
+            cfg.notOkLimit = atoi(argv[++i]);
+        } else if(strcmp(a, "--noise") == 0 && hasValue) {
+            cfg.noiseFloorAmps = atof(argv[++i]);
+        } else if(strcmp(a, "--backoff") == 0 && hasValue) {
+            cfg.backoffMs = atoi(argv[++i]) * 1000;
+        } else if(strcmp(a, "--min-run") == 0 && hasValue) {
+            cfg.minRunMs = atoi(argv[++i]) * 1000;
+        } else if(strcmp(a, "--min-rest") == 0 && hasValue) {
+            cfg.minRestMs = atoi(argv[++i]) * 1000;
+        } else if(strcmp(a, "--repeat") == 0 && hasValue) {
+            repeat = atoi(argv[++i]);
+        } else if(strcmp(a, "-v") == 0) {
+            verbose = true;
+        } else if(a[0] == '-') {
+            fprintf(stderr, "unknown option %s\n", a);
+            return 1;
+        } else {
+            paths.push_back(a);
+        }
+    }
+
+    if(paths.empty()) {
+        fprintf(stderr, "usage: replay [options] trace.trc ...\n");
+        return 1;
+    }
+
+    std::vector<uint8_t> data;
+    for(size_t i = 0; i < paths.size(); i++) {
+        if(!readFile(paths[i], &data)) {
+            return 1;
+        }
+    }
+
+    printf("offset %.3fV%s  band %.0f-%.0fW  limit %u  noise %.2fA  backoff %us  run >= %us  rest >= %us\n",
+           cfg.offset, warmStart ? " (warm)" : "", cfg.badLoadWattsLow, cfg.badLoadWattsHigh, cfg.notOkLimit,
+           cfg.noiseFloorAmps, cfg.backoffMs / 1000, cfg.minRunMs / 1000, cfg.minRestMs / 1000);
+
+    static uint16_t samples[MAX_SAMPLES];
+    uint64_t records = 0, totalSamples = 0, corrupt = 0, mismatches = 0, backoffs = 0;
+    uint64_t powerNs = 0, controlNs = 0, transitions = 0;
+    uint32_t firstMs = 0, lastMs = 0;
+    DcTracker dc;
+
+    Clock::time_point wallStart = Clock::now();
+
+    for(int r = 0; r < repeat; r++) {
+        State state;
+        memset(&state, 0, sizeof(state));
+        state.pumpOk = true;
+
+        dcTrackerInit(&dc, &cfg);
+        if(warmStart) {
+            dcTrackerRestore(&dc, dc.biasQ16);
+        }
+
+        PumpController ctl;
+        bool haveCtl = false;
+
+        bool printing = (r == 0);
+        bool havePrev = false;
+        bool prevPumpOn = false;
+        size_t pos = 0;
+
+        while(pos < data.size()) {
+            TraceRecord rec;
+            size_t used = traceDecode(&data[pos], data.size() - pos, &rec, samples, MAX_SAMPLES);
+            if(used == 0) {
+                // Resync on the next byte, a truncated MQTT payload shouldn't end the replay
+                corrupt++;
+                pos++;
+                continue;
+            }
+            pos += used;
+
+            size_t n = rec.numSamples < MAX_SAMPLES ? rec.numSamples : MAX_SAMPLES;
+            state.req1 = rec.flags & TRACE_FLAG_REQ_1;
+            state.req2 = rec.flags & TRACE_FLAG_REQ_2;
+
+            // The recorded relay state is the decision the device made on the previous poll
+            if(havePrev && prevPumpOn != (bool)(rec.flags & TRACE_FLAG_RELAY)) {
+                mismatches++;
+            }
+
+            // Start the controller on the trace's clock
+            if(!haveCtl) {
+                pumpControlInit(&ctl, &cfg, rec.timeMs);
+                haveCtl = true;
+            }
+            uint32_t logged = ctl.logCount;
+
+            Clock::time_point t0 = Clock::now();
+            ctApparentPower(&cfg, &dc, samples, n, &state);
+            uint64_t t1 = nanosSince(t0);
+            pumpControlStep(&ctl, &state, rec.timeMs);
+            uint64_t t2 = nanosSince(t0);
+
+            powerNs += t1;
+            controlNs += t2 - t1;
+
+            for(uint32_t k = logged; k < ctl.logCount; k++) {
+                const PumpTransitionRecord *tr = &ctl.log[k % PUMP_LOG_SIZE];
+                transitions++;
+                if(tr->to == PUMP_BACKOFF) {
+                    backoffs++;
+                }
+                if(printing) {
+                    printf("%10.1fs  %7.1fW  %5.2fA  %-8s -> %-8s on %s\n",
+                           tr->timeMs / 1000.0, state.power, state.current, pumpStateName(tr->from),
+                           pumpStateName(tr->to), pumpEventName(tr->event));
+                }
+            }
+
+            if(printing && verbose) {
+                printf("%10.1fs  %7.1fW  %5.2fA  %-8s pump %-3s\n", rec.timeMs / 1000.0, state.power,
+                       state.current, pumpStateName(state.pumpState), state.pumpOn ? "ON" : "OFF");
+            }
+
+            if(records == 0) {
+                firstMs = rec.timeMs;
+            }
+            lastMs = rec.timeMs;
+            prevPumpOn = state.pumpOn;
+            havePrev = true;
+            records++;
+            totalSamples += n;
+        }
+    }
+
+    double wallSec = nanosSince(wallStart) / 1e9;
+    if(records == 0) {
+        fprintf(stderr, "no records\n");
+        return 1;
+    }
+
+    double simSec = (lastMs - firstMs) / 1000.0 * repeat;
+    printf("\n%llu records, %llu samples, %llu corrupt bytes skipped\n",
+           (unsigned long long)records, (unsigned long long)totalSamples, (unsigned long long)corrupt);
+    printf("%llu transitions, %llu backoffs started, %llu relay decisions differ from the recording\n",
+           (unsigned long long)transitions, (unsigned long long)backoffs, (unsigned long long)mismatches);
+    printf("final DC offset estimate %.4fV\n", dcTrackerVolts(&dc));
+    printf("per record: ctApparentPower %.0fns  pumpControlStep %.0fns\n",
+           (double)powerNs / records, (double)controlNs / records);
+    printf("throughput: %.0f records/s  %.1f Msamples/s  %.0fx real time\n",
+           records / wallSec, totalSamples / wallSec / 1e6, simSec / wallSec);
+    return 0;
+}
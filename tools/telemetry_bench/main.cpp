@@ -0,0 +1,178 @@
+/* telemetry_bench - payload size and encode time, text vs CBOR telemetry
+ *
+ * Text is what TELEMETRY_TEXT publishes each poll: one decimal value per
+ * topic (topic bytes counted, they go over the wire too). CBOR is the single
+ * TLM_FRAME_STATE frame plus its topic. The HomeAssistant JSON state is sent
+ * in both modes and reported on its own. The metrics frame is compared
+ * against the same metrics as text topics. Text is timed both with the
+ * textwriter.h formatting the firmware uses and with the printf it replaced.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "telemetry.h"
+#include "textwriter.h"
+#include "topics.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static const size_t stateTopicBytes =
+    Topics::TLM_WATER_REQUEST_1.length + Topics::TLM_WATER_REQUEST_2.length + Topics::TLM_PUMP_ON.length +
+    Topics::TLM_BACKOFF.length + Topics::TLM_PUMP_NOT_OK_COUNT.length + Topics::TLM_MAINS_VOLTS.length +
+    Topics::TLM_CURRENT_AMPS.length + Topics::TLM_POWER_WATTS.length + Topics::TLM_BACKOFF_TIMEOUT_S.length;
+
+// Same as publishHAState()
+static size_t encodeJson(const State *s, char *out) {
+    TextWriter w;
+    textWriterInit(&w, out, 100);
+    textWriteStr(&w, "{\"state\": \"");
+    textWriteStr(&w, s->pumpOn ? "ON" : "OFF");
+    textWriteStr(&w, "\", \"current\": ");
+    textWriteFixed(&w, s->current, 2);
+    textWriteStr(&w, ", \"power\": ");
+    textWriteFixed(&w, s->power, 0);
+    textWriteStr(&w, "}");
+    return w.len;
+}
+
+// Same formatting as publishStateText(), returns topic + payload bytes
+static size_t encodeText(const State *s) {
+    char values[9][24];
+    TextWriter w[9];
+    for(int i = 0; i < 9; i++) {
+        textWriterInit(&w[i], values[i], sizeof(values[i]));
+    }
+
+    textWriteStr(&w[0], s->req1 ? "0" : "1");
+    textWriteStr(&w[1], s->req2 ? "0" : "1");
+    textWriteStr(&w[2], s->pumpOn ? "ON" : "OFF");
+    textWriteStr(&w[3], s->backoff ? "ON" : "OFF");
+    textWriteUint(&w[4], s->pumpNotOkCount);
+    textWriteFixed(&w[5], s->voltage, 2);
+    textWriteFixed(&w[6], s->current, 2);
+    textWriteFixed(&w[7], s->power, 2);
+    textWriteUint(&w[8], s->backoffTimeoutSeconds);
+
+    size_t bytes = stateTopicBytes;
+    for(int i = 0; i < 9; i++) {
+        bytes += w[i].len;
+    }
+    return bytes;
+}
+
+// The sprintf() version publishStateText() used before textwriter.h
+static size_t encodeTextPrintf(const State *s) {
+    char values[9][24];
+    const char *pumpState = s->pumpOn ? "ON" : "OFF";
+
+    sprintf(values[0], "%d", !s->req1);
+    sprintf(values[1], "%d", !s->req2);
+    strcpy(values[2], pumpState);
+    strcpy(values[3], s->backoff ? "ON" : "OFF");
+    sprintf(values[4], "%u", s->pumpNotOkCount);
+    sprintf(values[5], "%.2f", s->voltage);
+    sprintf(values[6], "%.2f", s->current);
+    sprintf(values[7], "%.2f", s->power);
+    sprintf(values[8], "%lu", s->backoffTimeoutSeconds);
+
+    size_t bytes = stateTopicBytes;
+    for(int i = 0; i < 9; i++) {
+        bytes += strlen(values[i]);
+    }
+    return bytes;
+}
+
+static size_t encodeTextMetrics(const MetricsFrame *m, char *out) {
+    size_t bytes = 0;
+    for(unsigned int i = 0; i < m->count; i++) {
+        bytes += strlen(telemetryTopic((TelemetryKey)m->keys[i]));
+        TextWriter w;
+        textWriterInit(&w, out, 24);
+        textWriteFixed(&w, m->values[i], 2);
+        bytes += w.len;
+    }
+    return bytes;
+}
+
+int main() {
+    const int N = 100000;
+    std::mt19937 rng(1);
+    std::normal_distribution<float> noise(0.0f, 0.05f);
+
+    std::vector<State> states(N);
+    for(int i = 0; i < N; i++) {
+        State &s = states[i];
+        memset(&s, 0, sizeof(s));
+        s.pumpOn = (i / 50) % 3 != 0;
+        s.pumpOk = true;
+        s.req1 = !s.pumpOn;
+        s.req2 = true;
+        s.voltage = 120.0f;
+        s.current = s.pumpOn ? 15.5f + noise(rng) : 0.0f;
+        s.power = s.voltage * s.current;
+    }
+
+    MetricsFrame metrics;
+    metricsFrameInit(&metrics);
+    metricsFrameAdd(&metrics, TLM_CHECK_REQUEST_MS, 0);
+    metricsFrameAdd(&metrics, TLM_READ_CT_MS, 51);
+    metricsFrameAdd(&metrics, TLM_HISTORY_BYTES_SAMPLE, 4.87f);
+    metricsFrameAdd(&metrics, TLM_DC_OFFSET_MV, 1644.37f);
+    metricsFrameAdd(&metrics, TLM_ADC_MV, 1650);
+    metricsFrameAdd(&metrics, TLM_ADC_ADJUSTED_MV, 5.63f);
+    metricsFrameAdd(&metrics, TLM_ADC_VALUE, 2041);
+
+    char text[512];
+    uint8_t frame[TELEMETRY_FRAME_BYTES];
+    size_t textBytes = 0, cborBytes = 0, jsonBytes = 0;
+
+    Clock::time_point t0 = Clock::now();
+    for(int i = 0; i < N; i++) {
+        textBytes += encodeText(&states[i]);
+    }
+    double textSec = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    size_t printfBytes = 0;
+    t0 = Clock::now();
+    for(int i = 0; i < N; i++) {
+        printfBytes += encodeTextPrintf(&states[i]);
+    }
+    double printfSec = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    t0 = Clock::now();
+    for(int i = 0; i < N; i++) {
+        cborBytes += Topics::CBOR_STATE.length + telemetryEncodeState(&states[i], i * 10000, frame, sizeof(frame));
+    }
+    double cborSec = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    t0 = Clock::now();
+    for(int i = 0; i < N; i++) {
+        jsonBytes += Topics::HA_STATE.length + encodeJson(&states[i], text);
+    }
+    double jsonSec = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    printf("state    text %6.1f B/poll %7.0f ns    cbor %6.1f B/poll %7.0f ns\n",
+           (double)textBytes / N, textSec / N * 1e9, (double)cborBytes / N, cborSec / N * 1e9);
+    printf("state  printf %6.1f B/poll %7.0f ns\n", (double)printfBytes / N, printfSec / N * 1e9);
+    printf("HA json  both %6.1f B/poll %7.0f ns\n", (double)jsonBytes / N, jsonSec / N * 1e9);
+
+    textBytes = cborBytes = 0;
+    t0 = Clock::now();
+    for(int i = 0; i < N; i++) {
+        textBytes += encodeTextMetrics(&metrics, text);
+    }
+    textSec = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    t0 = Clock::now();
+    for(int i = 0; i < N; i++) {
+        cborBytes += Topics::CBOR_METRICS.length + telemetryEncodeMetrics(&metrics, i * 10000, frame, sizeof(frame));
+    }
+    cborSec = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    printf("metrics  text %6.1f B/poll %7.0f ns    cbor %6.1f B/poll %7.0f ns\n",
+           (double)textBytes / N, textSec / N * 1e9, (double)cborBytes / N, cborSec / N * 1e9);
+    return 0;
+}
@@ -0,0 +1,86 @@
+/* telemetry_decode - print CBOR telemetry frames as JSON lines
+ *
+ * Frames are self-delimiting so payloads can simply be appended to a file:
+ *   mosquitto_sub -h homeassistant.local -t 'well/monitor/cbor/#' -N > frames.cbor
+ *   telemetry_decode frames.cbor
+ *
+ * Reads stdin when no file is given.
+ */
+#include <cstdio>
+#include <vector>
+
+#include "cbor.h"
+#include "telemetry.h"
+
+static void printValue(const CborItem &v) {
+    switch(v.type) {
+    case CBOR_UINT:
+    case CBOR_NEGINT:
+        printf("%lld", (long long)v.i);
+        break;
+    case CBOR_FLOAT:
+        printf("%g", v.f);
+        break;
+    case CBOR_BOOL:
+        printf("%s", v.b ? "true" : "false");
+        break;
+    case CBOR_TEXT:
+        printf("\"%.*s\"", (int)v.count, v.text);
+        break;
+    default:
+        printf("null");
+        break;
+    }
+}
+
+int main(int argc, char **argv) {
+    FILE *f = stdin;
+    if(argc > 1) {
+        f = fopen(argv[1], "rb");
+        if(f == NULL) {
+            fprintf(stderr, "unable to open %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t buf[65536];
+    size_t n;
+    while((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+
+    CborReader r;
+    cborReaderInit(&r, data.data(), data.size());
+
+    unsigned int frames = 0;
+    CborItem item;
+    while(r.pos < r.len) {
+        if(!cborRead(&r, &item) || item.type != CBOR_MAP) {
+            fprintf(stderr, "not a telemetry frame at byte %zu\n", r.pos);
+            return 1;
+        }
+
+        printf("{");
+        for(uint32_t i = 0; i < item.count; i++) {
+            CborItem key, value;
+            if(!cborRead(&r, &key) || key.type != CBOR_UINT || !cborRead(&r, &value)) {
+                fprintf(stderr, "\ncorrupt frame at byte %zu\n", r.pos);
+                return 1;
+            }
+
+            const char *name = telemetryKeyName((uint32_t)key.i);
+            if(name != NULL) {
+                printf("%s\"%s\": ", i ? ", " : "", name);
+            } else {
+                printf("%s\"%lld\": ", i ? ", " : "", (long long)key.i);
+            }
+            printValue(value);
+        }
+        printf("}\n");
+        frames++;
+    }
+
+    fprintf(stderr, "%u frames, %zu bytes\n", frames, data.size());
+    return 0;
+}